@@ -0,0 +1,201 @@
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <sstream>
+#include <assert.h>
+#include <map>
+#include <vector>
+#include "pin.H"
+
+// Basic block vector profiler. Every -i instructions each thread writes the
+// number of instructions it executed in every basic block during that
+// interval, in the SimPoint .bb format:
+//
+//   T:<block id>:<instructions> :<block id>:<instructions> ...
+//
+// Block ids start at 1 and are assigned in the order blocks are first
+// instrumented. simpoint.py clusters the vectors to pick simulation points.
+
+// Each thread counts into its own pages of COUNT_PAGE_SIZE block counters,
+// indexed by block id, so threads never write to each other's cache lines.
+#define COUNT_PAGE_BITS 12
+#define COUNT_PAGE_SIZE (1u << COUNT_PAGE_BITS)
+#define MAX_COUNT_PAGES 65536
+
+// This knob sets the output file prefix
+KNOB<string> KnobOutputPrefix(KNOB_MODE_WRITEONCE, "pintool", "o", "bbv", "specify the output file prefix, thread N writes <prefix>.T<N>.bb");
+
+// This knob sets the length of an interval
+KNOB<UINT64> KnobIntervalSize(KNOB_MODE_WRITEONCE, "pintool", "i", "100000000", "specify the number of instructions in an interval");
+
+// Per-thread interval state
+struct ThreadData {
+	// Instructions executed in the current interval
+	UINT64 intervalIns;
+	// Instructions executed in each block this interval, by block id. Every
+	// page a block id falls in is allocated before that block is instrumented,
+	// so the counting routine stays a single inlined add.
+	UINT64 **countPages;
+	ofstream *outfile;
+};
+
+// Block ids by start address, only used while instrumenting
+static std::map<ADDRINT, UINT32> blockIds;
+
+// Guards numBlocks and threads, which instrumentation and thread start and
+// exit update while other threads dump intervals
+static PIN_LOCK blocksLock;
+static UINT32 numBlocks = 0;
+static std::vector<ThreadData*> threads;
+
+static TLS_KEY tlsKey;
+
+// Tool register holding the current thread's ThreadData
+static REG scratchReg;
+
+static UINT64 intervalSize;
+
+// Called at the start of every basic block
+VOID PIN_FAST_ANALYSIS_CALL countBlock(ThreadData *tdata, UINT32 page, UINT32 offset, UINT32 numIns) {
+	tdata->countPages[page][offset] += numIns;
+}
+
+// Returns true when the thread's current interval is full
+ADDRINT PIN_FAST_ANALYSIS_CALL countInterval(ThreadData *tdata, UINT32 numIns) {
+	tdata->intervalIns += numIns;
+	return tdata->intervalIns >= intervalSize;
+}
+
+// Writes and clears the thread's vector for the current interval
+VOID dumpInterval(THREADID tid, ThreadData *tdata) {
+	PIN_GetLock(&blocksLock, tid + 1);
+	UINT32 blocksNow = numBlocks;
+	PIN_ReleaseLock(&blocksLock);
+
+	*tdata->outfile << "T";
+	for (UINT32 id = 1; id <= blocksNow; id++) {
+		UINT64 &count = tdata->countPages[id >> COUNT_PAGE_BITS][id & (COUNT_PAGE_SIZE - 1)];
+		if (count) {
+			*tdata->outfile << ":" << id << ":" << count << " ";
+			count = 0;
+		}
+	}
+	*tdata->outfile << "\n";
+	tdata->intervalIns = 0;
+}
+
+// Looks up the id of the block starting at address, creating it the first
+// time. A block that starts a new page of counters allocates that page for
+// every running thread.
+static UINT32 getBlock(ADDRINT address) {
+	std::map<ADDRINT, UINT32>::iterator it = blockIds.find(address);
+	if (it != blockIds.end())
+		return it->second;
+
+	PIN_GetLock(&blocksLock, PIN_ThreadId() + 1);
+	UINT32 id = ++numBlocks;
+	if (id >> COUNT_PAGE_BITS >= MAX_COUNT_PAGES) {
+		cerr << "More than " << (UINT64)MAX_COUNT_PAGES * COUNT_PAGE_SIZE - 1 << " basic blocks" << endl;
+		PIN_ExitProcess(1);
+	}
+	if ((id & (COUNT_PAGE_SIZE - 1)) == 0) {
+		for (UINT32 t = 0; t < threads.size(); t++)
+			threads[t]->countPages[id >> COUNT_PAGE_BITS] = new UINT64[COUNT_PAGE_SIZE]();
+	}
+	PIN_ReleaseLock(&blocksLock);
+
+	blockIds[address] = id;
+	return id;
+}
+
+// Pin calls this function every time a new trace is encountered
+VOID Trace(TRACE trace, VOID *v)
+{
+	for (BBL bbl = TRACE_BblHead(trace); BBL_Valid(bbl); bbl = BBL_Next(bbl)) {
+		UINT32 numIns = BBL_NumIns(bbl);
+		UINT32 id = getBlock(BBL_Address(bbl));
+		BBL_InsertCall(bbl, IPOINT_BEFORE, (AFUNPTR)countBlock, IARG_FAST_ANALYSIS_CALL,
+					   IARG_REG_VALUE, scratchReg, IARG_UINT32, id >> COUNT_PAGE_BITS,
+					   IARG_UINT32, id & (COUNT_PAGE_SIZE - 1), IARG_UINT32, numIns, IARG_END);
+
+		BBL_InsertIfCall(bbl, IPOINT_BEFORE, (AFUNPTR)countInterval, IARG_FAST_ANALYSIS_CALL,
+						 IARG_REG_VALUE, scratchReg, IARG_UINT32, numIns, IARG_END);
+		BBL_InsertThenCall(bbl, IPOINT_BEFORE, (AFUNPTR)dumpInterval,
+						   IARG_THREAD_ID, IARG_REG_VALUE, scratchReg, IARG_END);
+	}
+}
+
+VOID ThreadStart(THREADID tid, CONTEXT *ctxt, INT32 flags, VOID *v)
+{
+	ThreadData *tdata = new ThreadData;
+	tdata->intervalIns = 0;
+	tdata->countPages = new UINT64*[MAX_COUNT_PAGES]();
+
+	// Pages for every block instrumented so far
+	PIN_GetLock(&blocksLock, tid + 1);
+	for (UINT32 page = 0; page <= numBlocks >> COUNT_PAGE_BITS; page++)
+		tdata->countPages[page] = new UINT64[COUNT_PAGE_SIZE]();
+	threads.push_back(tdata);
+	PIN_ReleaseLock(&blocksLock);
+
+	ostringstream fileName;
+	fileName << KnobOutputPrefix.Value() << ".T" << tid << ".bb";
+	tdata->outfile = new ofstream(fileName.str().c_str());
+
+	PIN_SetThreadData(tlsKey, tdata, tid);
+	PIN_SetContextReg(ctxt, scratchReg, (ADDRINT)tdata);
+}
+
+// Writes the thread's last, partial interval
+VOID ThreadFini(THREADID tid, const CONTEXT *ctxt, INT32 code, VOID *v)
+{
+	ThreadData *tdata = static_cast<ThreadData*>(PIN_GetThreadData(tlsKey, tid));
+	if (tdata->intervalIns)
+		dumpInterval(tid, tdata);
+
+	tdata->outfile->close();
+	delete tdata->outfile;
+
+	PIN_GetLock(&blocksLock, tid + 1);
+	for (UINT32 t = 0; t < threads.size(); t++) {
+		if (threads[t] == tdata) {
+			threads.erase(threads.begin() + t);
+			break;
+		}
+	}
+	for (UINT32 page = 0; page <= numBlocks >> COUNT_PAGE_BITS; page++)
+		delete[] tdata->countPages[page];
+	PIN_ReleaseLock(&blocksLock);
+
+	delete[] tdata->countPages;
+	delete tdata;
+}
+
+// argc, argv are the entire command line, including pin -t <toolname> -- ...
+int main(int argc, char * argv[])
+{
+	// Initialize pin
+	PIN_Init(argc, argv);
+
+	intervalSize = KnobIntervalSize.Value();
+
+	PIN_InitLock(&blocksLock);
+	tlsKey = PIN_CreateThreadDataKey(0);
+	scratchReg = PIN_ClaimToolRegister();
+	if (!REG_valid(scratchReg)) {
+		cerr << "Cannot allocate a scratch register" << endl;
+		return 1;
+	}
+
+	// Register Trace to be called to instrument basic blocks
+	TRACE_AddInstrumentFunction(Trace, 0);
+
+	PIN_AddThreadStartFunction(ThreadStart, 0);
+	PIN_AddThreadFiniFunction(ThreadFini, 0);
+
+	// Start the program, never returns
+	PIN_StartProgram();
+
+	return 0;
+}
@@ -0,0 +1,178 @@
+#!/usr/bin/python3
+"""Picks simulation points from basic block vectors written by bbvProfiler.
+
+    ./simpoint.py bbv.T0.bb [-k 10] [-o bbv]
+
+Each interval's vector is normalised, randomly projected down to a few
+dimensions and clustered with k-means for every k up to -k. The smallest k
+whose BIC score reaches 90% of the best is kept, as SimPoint does. For each
+cluster, the interval closest to its centroid is the simulation point and the
+fraction of intervals in the cluster is its weight. They are written to
+<prefix>.simpoints and <prefix>.weights in SimPoint's "<value> <cluster>"
+format.
+
+To simulate a point with the other tools, fast-forward to its start:
+    -ff <point * interval size> -warmup <W> -detail <interval size>
+(subtract W from -ff to warm up just before the interval).
+"""
+import argparse
+import math
+import random
+import sys
+
+
+def load_vectors(bb_file):
+    """Returns one {block id: instructions} dict per interval."""
+    vectors = []
+    with open(bb_file) as f:
+        for line in f:
+            if not line.startswith('T'):
+                continue
+            vector = {}
+            for entry in line[1:].split():
+                _, block, count = entry.split(':')
+                vector[int(block)] = int(count)
+            vectors.append(vector)
+    return vectors
+
+
+def project(vectors, dims, seed):
+    """Normalises each vector and projects it onto `dims` random dimensions."""
+    rng = random.Random(seed)
+    projection = {}
+    points = []
+    for vector in vectors:
+        total = sum(vector.values()) or 1
+        point = [0.0] * dims
+        for block, count in vector.items():
+            if block not in projection:
+                projection[block] = [rng.uniform(-1, 1) for _ in range(dims)]
+            weight = count / total
+            row = projection[block]
+            for d in range(dims):
+                point[d] += weight * row[d]
+        points.append(point)
+    return points
+
+
+def distance2(a, b):
+    return sum((x - y) ** 2 for x, y in zip(a, b))
+
+
+def kmeans(points, k, rng, iterations=100):
+    """Clusters points with k-means++ seeding. Returns (centroids, labels)."""
+    centroids = [rng.choice(points)]
+    while len(centroids) < k:
+        weights = [min(distance2(p, c) for c in centroids) for p in points]
+        if not sum(weights):
+            break
+        centroids.append(rng.choices(points, weights)[0])
+
+    labels = None
+    for _ in range(iterations):
+        new_labels = [min(range(len(centroids)), key=lambda c: distance2(p, centroids[c]))
+                      for p in points]
+        if new_labels == labels:
+            break
+        labels = new_labels
+
+        for c in range(len(centroids)):
+            members = [p for p, label in zip(points, labels) if label == c]
+            if members:
+                centroids[c] = [sum(col) / len(members) for col in zip(*members)]
+    return centroids, labels
+
+
+def bic(points, centroids, labels):
+    """Bayesian information criterion of a clustering (Pelleg and Moore)."""
+    r = len(points)
+    m = len(points[0])
+    k = len(centroids)
+    if r <= k:
+        return float('-inf')
+
+    distortion = sum(distance2(p, centroids[label]) for p, label in zip(points, labels))
+    variance = max(distortion / (r - k), 1e-12)
+
+    log_likelihood = 0.0
+    for c in range(k):
+        r_c = labels.count(c)
+        if not r_c:
+            continue
+        log_likelihood += (-r_c / 2 * math.log(2 * math.pi)
+                           - r_c * m / 2 * math.log(variance)
+                           - (r_c - k) / 2
+                           + r_c * math.log(r_c)
+                           - r_c * math.log(r))
+    parameters = (k - 1) + m * k + 1
+    return log_likelihood - parameters / 2 * math.log(r)
+
+
+def pick_simpoints(points, max_k, seeds, bic_threshold=0.9):
+    """Returns [(interval, cluster, weight)] for the chosen clustering."""
+    # One interval is its own simulation point, and BIC needs more points
+    # than clusters
+    if len(points) <= 1:
+        return [(0, 0, 1.0)]
+
+    rng = random.Random(513)
+    max_k = min(max_k, len(points))
+
+    # Best of several seedings for every k
+    clusterings = []
+    for k in range(1, max_k + 1):
+        best = None
+        for _ in range(seeds):
+            centroids, labels = kmeans(points, k, rng)
+            score = bic(points, centroids, labels)
+            if best is None or score > best[0]:
+                best = (score, centroids, labels)
+        clusterings.append(best)
+
+    scores = [c[0] for c in clusterings if c[0] != float('-inf')]
+    if scores:
+        low, high = min(scores), max(scores)
+        chosen = next(c for c in clusterings
+                      if c[0] >= low + bic_threshold * (high - low))
+    else:
+        chosen = clusterings[0]
+    _, centroids, labels = chosen
+
+    simpoints = []
+    for c, centroid in enumerate(centroids):
+        members = [i for i, label in enumerate(labels) if label == c]
+        if not members:
+            continue
+        closest = min(members, key=lambda i: distance2(points[i], centroid))
+        simpoints.append((closest, c, len(members) / len(points)))
+    return simpoints
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('bb_file', help='basic block vector file from bbvProfiler')
+    parser.add_argument('-k', type=int, default=10, help='maximum number of clusters')
+    parser.add_argument('-d', '--dims', type=int, default=15, help='projected dimensions')
+    parser.add_argument('-s', '--seeds', type=int, default=5, help='k-means seedings per k')
+    parser.add_argument('-o', '--output', help='output prefix (defaults to the input name)')
+    opts = parser.parse_args()
+
+    vectors = load_vectors(opts.bb_file)
+    if not vectors:
+        sys.exit(f'No intervals in {opts.bb_file}')
+
+    points = project(vectors, opts.dims, seed=513)
+    simpoints = pick_simpoints(points, opts.k, opts.seeds)
+
+    prefix = opts.output or opts.bb_file.rsplit('.bb', 1)[0]
+    with open(f'{prefix}.simpoints', 'w') as f:
+        for interval, cluster, _ in simpoints:
+            f.write(f'{interval} {cluster}\n')
+    with open(f'{prefix}.weights', 'w') as f:
+        for _, cluster, weight in simpoints:
+            f.write(f'{weight:0.6f} {cluster}\n')
+
+    print(f'{len(vectors)} intervals, {len(simpoints)} simulation points:')
+    for interval, cluster, weight in sorted(simpoints):
+        print(f'\tinterval {interval} (cluster {cluster}): weight {weight:0.3f}')
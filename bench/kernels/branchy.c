@@ -0,0 +1,25 @@
+// Data dependent branches on pseudo-random values, most of which a
+// predictor cannot learn.
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char *argv[])
+{
+	size_t iters = argc > 1 ? strtoul(argv[1], NULL, 0) : (1u << 25);
+
+	unsigned int x = 513;
+	long taken = 0;
+	for (size_t i = 0; i < iters; i++) {
+		// Linear congruential generator
+		x = x * 1103515245u + 12345u;
+		if (x & 0x10000)
+			taken += 3;
+		else if (x & 0x20000)
+			taken -= 1;
+		if ((i & 7) == 0)
+			taken ^= 1;
+	}
+
+	printf("%ld\n", taken);
+	return 0;
+}
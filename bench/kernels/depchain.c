@@ -0,0 +1,18 @@
+// A single long chain of dependent integer operations with no memory
+// traffic, so every instruction waits on the one before it.
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char *argv[])
+{
+	size_t iters = argc > 1 ? strtoul(argv[1], NULL, 0) : (1u << 26);
+
+	unsigned long x = 513;
+	for (size_t i = 0; i < iters; i++) {
+		x = x * 6364136223846793005ul + 1442695040888963407ul;
+		x ^= x >> 17;
+	}
+
+	printf("%lu\n", x);
+	return 0;
+}
@@ -0,0 +1,35 @@
+// Pointer chasing through a random cyclic permutation. Every load depends on
+// the previous one and most miss in the cache.
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char *argv[])
+{
+	size_t nodes = argc > 1 ? strtoul(argv[1], NULL, 0) : (1u << 20);
+	size_t steps = argc > 2 ? strtoul(argv[2], NULL, 0) : (1u << 22);
+
+	size_t *next = malloc(nodes * sizeof(size_t));
+	size_t *order = malloc(nodes * sizeof(size_t));
+	for (size_t i = 0; i < nodes; i++)
+		order[i] = i;
+
+	// Shuffle, then link the nodes in shuffled order into one cycle
+	srand(513);
+	for (size_t i = nodes - 1; i > 0; i--) {
+		size_t j = (size_t)rand() % (i + 1);
+		size_t tmp = order[i];
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+	for (size_t i = 0; i < nodes; i++)
+		next[order[i]] = order[(i + 1) % nodes];
+
+	size_t p = order[0];
+	for (size_t i = 0; i < steps; i++)
+		p = next[p];
+
+	printf("%zu\n", p);
+	free(order);
+	free(next);
+	return 0;
+}
@@ -0,0 +1,32 @@
+// STREAM-style triad over arrays larger than the cache. Independent, unit
+// stride loads and stores.
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char *argv[])
+{
+	size_t n = argc > 1 ? strtoul(argv[1], NULL, 0) : (1u << 21);
+	size_t reps = argc > 2 ? strtoul(argv[2], NULL, 0) : 10;
+
+	double *a = malloc(n * sizeof(double));
+	double *b = malloc(n * sizeof(double));
+	double *c = malloc(n * sizeof(double));
+	for (size_t i = 0; i < n; i++) {
+		b[i] = (double)i;
+		c[i] = (double)(n - i);
+	}
+
+	for (size_t r = 0; r < reps; r++)
+		for (size_t i = 0; i < n; i++)
+			a[i] = b[i] + 3.0 * c[i];
+
+	double sum = 0;
+	for (size_t i = 0; i < n; i++)
+		sum += a[i];
+
+	printf("%f\n", sum);
+	free(a);
+	free(b);
+	free(c);
+	return 0;
+}
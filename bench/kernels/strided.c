@@ -0,0 +1,26 @@
+// Sums an array with a fixed byte stride, touching one word per cache block
+// (or per page with a large stride).
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char *argv[])
+{
+	size_t bytes = argc > 1 ? strtoul(argv[1], NULL, 0) : (1u << 26);
+	size_t stride = argc > 2 ? strtoul(argv[2], NULL, 0) : 64;
+	size_t reps = argc > 3 ? strtoul(argv[3], NULL, 0) : 16;
+
+	size_t words = bytes / sizeof(int);
+	size_t step = stride / sizeof(int) ? stride / sizeof(int) : 1;
+	int *data = malloc(words * sizeof(int));
+	for (size_t i = 0; i < words; i++)
+		data[i] = (int)i;
+
+	long sum = 0;
+	for (size_t r = 0; r < reps; r++)
+		for (size_t i = 0; i < words; i += step)
+			sum += data[i];
+
+	printf("%ld\n", sum);
+	free(data);
+	return 0;
+}
@@ -0,0 +1,140 @@
+#!/usr/bin/python3
+"""Runs every benchmark kernel natively and under every pintool, and reports
+the slowdown and peak memory of each tool.
+
+    make && ./run_bench.py                  # compare against baseline.json
+    ./run_bench.py --save-baseline          # record a new baseline
+
+Results are written to bench_results.json. A tool/kernel pair regresses when
+its slowdown or peak memory grows by more than --tolerance over the baseline,
+in which case the script exits with status 1. Timings depend on the machine,
+so no baseline is kept in the repository: record one with --save-baseline on
+the machine you test on. Without a baseline the script exits with status 1
+before running anything.
+"""
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+# (name, command line) for each kernel, relative to this directory
+kernels = (
+    ('pointer_chase', ['./pointer_chase']),
+    ('stream', ['./stream']),
+    ('strided', ['./strided']),
+    ('branchy', ['./branchy']),
+    ('depchain', ['./depchain']),
+)
+
+# (name, pintool, extra knobs) for each tool
+tools = (
+    ('regDeps', os.path.join('..', 'lab1', 'regDeps.so'), []),
+    ('regDeps-mem', os.path.join('..', 'lab1', 'regDeps.so'), ['-mode', 'mem']),
+    ('regDeps-ilp', os.path.join('..', 'lab1', 'regDeps.so'), ['-mode', 'ilp']),
+    ('bpredictor', os.path.join('..', 'lab2', 'bpredictor.so'), []),
+    ('caches', os.path.join('..', 'lab3', 'caches.so'), []),
+    ('cpiModel', os.path.join('..', 'cpi', 'cpiModel.so'), []),
+    ('bbvProfiler', os.path.join('..', 'bbv', 'bbvProfiler.so'), []),
+)
+
+
+def measure(args, runs):
+    """Runs a command `runs` times. Returns the fastest wall time in seconds
+    and the largest peak resident set size in KB."""
+    best_time = None
+    peak_kb = 0
+    for _ in range(runs):
+        start = time.perf_counter()
+        proc = subprocess.Popen(args, stdout=subprocess.DEVNULL)
+        _, status, usage = os.wait4(proc.pid, 0)
+        elapsed = time.perf_counter() - start
+        proc.returncode = os.waitstatus_to_exitcode(status)
+        if proc.returncode != 0:
+            raise RuntimeError(f'{" ".join(args)} exited with {proc.returncode}')
+
+        best_time = elapsed if best_time is None else min(best_time, elapsed)
+        peak_kb = max(peak_kb, usage.ru_maxrss)
+    return best_time, peak_kb
+
+
+def run_suite(pin, runs, output_dir):
+    results = {}
+    for kernel, kernel_args in kernels:
+        native_time, native_kb = measure(kernel_args, runs)
+        results[kernel] = {'native': {'time': native_time, 'peak_kb': native_kb}}
+        print(f'{kernel}: native {native_time:0.3f}s {native_kb}KB')
+
+        for tool, tool_path, knobs in tools:
+            if not os.path.exists(tool_path):
+                print(f'\t{tool}: skipped, {tool_path} is not built')
+                continue
+
+            out_file = os.path.join(output_dir, f'{kernel}_{tool}.out')
+            args = [pin, '-t', tool_path, '-o', out_file, *knobs, '--', *kernel_args]
+            tool_time, tool_kb = measure(args, runs)
+            slowdown = tool_time / native_time
+            results[kernel][tool] = {'time': tool_time, 'peak_kb': tool_kb,
+                                     'slowdown': slowdown}
+            print(f'\t{tool}: {tool_time:0.3f}s ({slowdown:0.1f}x) {tool_kb}KB')
+    return results
+
+
+def compare(results, baseline, tolerance):
+    """Prints every tool/kernel pair that got worse than the baseline.
+    Returns the number of regressions."""
+    regressions = 0
+    for kernel, kernel_results in results.items():
+        for tool, r in kernel_results.items():
+            b = baseline.get(kernel, {}).get(tool)
+            if tool == 'native' or b is None:
+                continue
+
+            for metric in ('slowdown', 'peak_kb'):
+                if r[metric] > b[metric] * (1 + tolerance):
+                    regressions += 1
+                    print(f'REGRESSION {kernel}/{tool} {metric}: '
+                          f'{b[metric]:0.2f} -> {r[metric]:0.2f}')
+    return regressions
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--pin', default=os.path.join('..', '..', 'base', 'pin', 'pin'),
+                        help='path to the pin launcher')
+    parser.add_argument('--runs', type=int, default=3,
+                        help='runs per measurement, the fastest is kept')
+    parser.add_argument('--baseline', default='baseline.json',
+                        help='stored results to compare against')
+    parser.add_argument('--save-baseline', action='store_true',
+                        help='store these results as the new baseline')
+    parser.add_argument('--tolerance', type=float, default=0.10,
+                        help='allowed fractional growth over the baseline')
+    opts = parser.parse_args()
+
+    # Kernels and tools are referenced relative to this directory
+    os.chdir(os.path.dirname(os.path.abspath(__file__)))
+
+    if not opts.save_baseline and not os.path.exists(opts.baseline):
+        sys.exit(f'No baseline at {opts.baseline}, run with --save-baseline first')
+
+    with tempfile.TemporaryDirectory() as output_dir:
+        results = run_suite(opts.pin, opts.runs, output_dir)
+
+    with open('bench_results.json', 'w') as f:
+        json.dump(results, f, indent=2)
+
+    if opts.save_baseline:
+        with open(opts.baseline, 'w') as f:
+            json.dump(results, f, indent=2)
+        print(f'Saved baseline to {opts.baseline}')
+        sys.exit()
+
+    with open(opts.baseline) as f:
+        baseline = json.load(f)
+    if compare(results, baseline, opts.tolerance):
+        sys.exit(1)
+    print('No regressions')
@@ -0,0 +1,324 @@
+// The lab 3 cache models, shared by caches and the CPI model so their cache
+// statistics are directly comparable. Include it after pin.H, sim_regions.h
+// and results_store.h, and set logPageSize and logPhysicalMemSize before
+// making a model.
+#ifndef CACHE_MODELS_H
+#define CACHE_MODELS_H
+
+UINT32 logPageSize;
+UINT32 logPhysicalMemSize;
+
+//Function to obtain physical page number given a virtual page number
+UINT64 getPhysicalPageNumber(UINT64 virtualPageNumber)
+{
+    INT32 key = (INT32) virtualPageNumber;
+    key = ~key + (key << 15); // key = (key << 15) - key - 1;
+    key = key ^ (key >> 12);
+    key = key + (key << 2);
+    key = key ^ (key >> 4);
+    key = key * 2057; // key = (key + (key << 3)) + (key << 11);
+    key = key ^ (key >> 16);
+    return (UINT32) (key&(((UINT32)(~0))>>(32-logPhysicalMemSize)));
+}
+
+class CacheModel
+{
+    protected:
+        UINT32   logNumRows;
+        UINT32   logBlockSize;
+        UINT32   associativity;
+        UINT64   readReqs;
+        UINT64   writeReqs;
+        UINT64   readHits;
+        UINT64   writeHits;
+        UINT32** tag;
+        bool**   validBit;
+
+
+		// Keeps track of set accesses for each row so we can
+		// find the least recentely used set for eviction/replacement.
+		UINT32** lruHistory;
+
+		// The following values are model-dependant 
+
+		// number of bits to right shift address to move index and tag bits to
+		// the lower bits.
+		UINT32 indexShiftBits;
+		UINT32 tagShiftBits;
+		
+		// Bitmasks for accessing the index and tag of an address, after shifting 
+		// the relevant section to the least significant bits.
+		UINT32 tagMask;
+		UINT32 indexMask;
+
+    public:
+        //Constructor for a cache
+        CacheModel(UINT32 logNumRowsParam, UINT32 logBlockSizeParam, UINT32 associativityParam)
+        {
+            logNumRows = logNumRowsParam;
+            logBlockSize = logBlockSizeParam;
+            associativity = associativityParam;
+            readReqs = 0;
+            writeReqs = 0;
+            readHits = 0;
+            writeHits = 0;
+			
+            tag = new UINT32*[1u<<logNumRows];
+            validBit = new bool*[1u<<logNumRows];
+			lruHistory = new UINT32*[1u<<logNumRows];
+            for(UINT32 i = 0; i < 1u<<logNumRows; i++)
+            {
+                tag[i] = new UINT32[associativity];
+                validBit[i] = new bool[associativity];
+				lruHistory[i] = new UINT32[associativity];
+                for(UINT32 j = 0; j < associativity; j++)
+				{
+                    validBit[i][j] = false;
+					lruHistory[i][j] = j;
+				}
+            }       
+        }
+
+        virtual ~CacheModel()
+        {
+            for(UINT32 i = 0; i < 1u<<logNumRows; i++)
+            {
+                delete[] tag[i];
+                delete[] validBit[i];
+                delete[] lruHistory[i];
+            }
+            delete[] tag;
+            delete[] validBit;
+            delete[] lruHistory;
+        }
+
+        //Call this function to update the cache state whenever data is read.
+        //Returns true on a hit.
+        virtual bool readReq(UINT32 virtualAddr) { return false; }
+
+        //Call this function to update the cache state whenever data is written.
+        //Returns true on a hit.
+        virtual bool writeReq(UINT32 virtualAddr) { return false; }
+
+        //Do not modify this function
+        virtual void dumpResults(ofstream *outfile)
+        {
+        	*outfile << readReqs <<","<< writeReqs <<","<< readHits <<","<< writeHits <<"\n";
+        }
+
+        // Adds this model's configuration and counters to the current row
+        virtual void storeResults(ResultsTable *table)
+        {
+            table->setUint("r", logNumRows);
+            table->setUint("b", logBlockSize);
+            table->setUint("a", associativity);
+            table->setUint("readReqs", readReqs);
+            table->setUint("writeReqs", writeReqs);
+            table->setUint("readHits", readHits);
+            table->setUint("writeHits", writeHits);
+        }
+
+        // Requests and hits counted while recording results
+        UINT64 requests() { return readReqs + writeReqs; }
+        UINT64 hits() { return readHits + writeHits; }
+
+	protected:
+		
+		// Traverses the cache at the given row for the tag.
+		// Returns true if it finds the tag (aka cache hit).
+		// Updates the cache structure after every search
+		bool searchCache(UINT32 row, UINT32 addressTag) 
+		{
+			for (UINT32 i = 0; i < associativity; i++)
+			{
+				if (validBit[row][i] && tag[row][i] == addressTag)
+				{
+					// Found the address in the cache, update access history
+					// and finish.
+					updateLruHistory(row, i);
+					return true;
+				}
+			}
+
+			// Cache miss, "load" the value into the cache and 
+			// update the lru history.
+			UINT32 replaceIndex = getLruReplacementIndex(row);
+			validBit[row][replaceIndex] = true;
+			tag[row][replaceIndex] = addressTag;
+			updateLruHistory(row, replaceIndex);
+			return false;
+		}
+
+		// Moves the accessed history to the bottom of the lru stack.
+		void updateLruHistory(UINT32 row, UINT32 accessedIndex)
+		{
+			UINT32 newHead = lruHistory[row][accessedIndex];
+			// Move the rest of the history down first first.
+			for (UINT32 i = accessedIndex; i > 0; i--) 
+			{
+				lruHistory[row][i] = lruHistory[row][i-1];
+			}
+			lruHistory[row][0] = newHead;
+		}
+
+		// Get the index of the least recently used element in the
+		// cache row.
+		UINT32 getLruReplacementIndex(UINT32 row) 
+		{
+			 return lruHistory[row][associativity-1];
+		}
+};
+
+class LruPhysIndexPhysTagCacheModel: public CacheModel
+{
+    public:
+        LruPhysIndexPhysTagCacheModel(UINT32 logNumRowsParam, UINT32 logBlockSizeParam, UINT32 associativityParam)
+            : CacheModel(logNumRowsParam, logBlockSizeParam, associativityParam)
+        {
+			// Create bitmasks and shift constants for accessing 
+			// the index and tag of an address.
+			indexShiftBits = logBlockSize + logPageSize;
+			indexMask = (1u << logNumRows) - 1;
+			tagShiftBits = logNumRows + logBlockSize;
+			tagMask = (1u << (32 - tagShiftBits)) - 1;
+        }
+
+        bool readReq(UINT32 virtualAddr)
+        {
+			// Find the row and tag, then pass to the base class to search the cache.
+			UINT32 physicalAddr = getPhysicalPageNumber(virtualAddr);
+			// The virtual addresses index bits are the same as the physical address.
+			UINT32 row = (virtualAddr >> indexShiftBits) & indexMask;
+			UINT32 addressTag = (physicalAddr >> tagShiftBits) & tagMask;  
+
+			bool success = CacheModel::searchCache(row, addressTag);
+			if (!regionsRecord())
+				return success;
+			if (success)
+				readHits++;
+			readReqs++;
+			return success;
+        }
+
+        bool writeReq(UINT32 virtualAddr)
+        {
+			UINT32 physicalAddr = getPhysicalPageNumber(virtualAddr);
+			
+			UINT32 row = (physicalAddr >> indexShiftBits) & indexMask;
+			UINT32 addressTag = (physicalAddr >> tagShiftBits) & tagMask;
+
+			bool success = CacheModel::searchCache(row, addressTag);
+			if (!regionsRecord())
+				return success;
+			if (success)
+				writeHits++;
+			writeReqs++;
+			return success;
+        }
+};
+
+class LruVirIndexPhysTagCacheModel: public CacheModel
+{
+    public:
+        LruVirIndexPhysTagCacheModel(UINT32 logNumRowsParam, UINT32 logBlockSizeParam, UINT32 associativityParam)
+            : CacheModel(logNumRowsParam, logBlockSizeParam, associativityParam)
+        {
+			indexShiftBits = logBlockSize + logPageSize;
+			indexMask = (1u << logNumRows) -1;
+			tagShiftBits = logNumRows + logBlockSize;
+			tagMask = (1u << (32 - tagShiftBits)) - 1;	
+        }
+
+        bool readReq(UINT32 virtualAddr)
+        {
+			UINT32 physicalAddr = getPhysicalPageNumber(virtualAddr);
+			UINT32 row = (virtualAddr >> indexShiftBits) & indexMask;
+			UINT32 addressTag = (physicalAddr >> tagShiftBits) & tagMask;
+
+			bool success = CacheModel::searchCache(row, addressTag);
+			if (!regionsRecord())
+				return success;
+			if (success)
+				readHits++;
+			readReqs++;
+			return success;
+        }
+
+        bool writeReq(UINT32 virtualAddr)
+        {
+			UINT32 physicalAddr = getPhysicalPageNumber(virtualAddr);
+			UINT32 row = (virtualAddr >> indexShiftBits) & indexMask;
+			UINT32 addressTag = (physicalAddr >> tagShiftBits) & tagMask;
+
+			bool success = CacheModel::searchCache(row, addressTag);
+			if (!regionsRecord())
+				return success;
+			if (success)
+				writeHits++;
+			writeReqs++;
+			return success;
+		}
+};
+
+class LruVirIndexVirTagCacheModel: public CacheModel
+{
+    public:
+        LruVirIndexVirTagCacheModel(UINT32 logNumRowsParam, UINT32 logBlockSizeParam, UINT32 associativityParam)
+            : CacheModel(logNumRowsParam, logBlockSizeParam, associativityParam)
+        {
+			indexShiftBits = logBlockSize + logPageSize;
+			indexMask = (1u << logNumRows) - 1;
+			tagShiftBits = logNumRows + logBlockSize;
+			tagMask = (1u << (32 - tagShiftBits)) - 1;
+        }
+
+        bool readReq(UINT32 virtualAddr)
+        {
+			UINT32 row = (virtualAddr >> indexShiftBits) & indexMask;
+			UINT32 addressTag = (virtualAddr >> tagShiftBits) & tagMask;
+
+			bool success = CacheModel::searchCache(row, addressTag);
+			if (!regionsRecord())
+				return success;
+			if (success)
+				readHits++;
+			readReqs++;
+			return success;
+        }
+
+        bool writeReq(UINT32 virtualAddr)
+        {
+			UINT32 row = (virtualAddr >> indexShiftBits) & indexMask;
+			UINT32 addressTag = (virtualAddr >> tagShiftBits) & tagMask;
+
+			bool success = CacheModel::searchCache(row, addressTag);
+			if (!regionsRecord())
+				return success;
+			if (success)
+				writeHits++;
+			writeReqs++;
+			return success;
+        }
+};
+
+// Whether kind is the short name of a model
+BOOL isCacheModel(const string &kind)
+{
+    return kind == "pp" || kind == "vp" || kind == "vv";
+}
+
+// Makes a model by its short name: pp (physical index physical tag), vp
+// (virtual index physical tag) or vv (virtual index virtual tag). Returns 0
+// for an unknown name.
+CacheModel *newCacheModel(const string &kind, UINT32 logNumRows, UINT32 logBlockSize, UINT32 associativity)
+{
+    if (kind == "pp")
+        return new LruPhysIndexPhysTagCacheModel(logNumRows, logBlockSize, associativity);
+    if (kind == "vp")
+        return new LruVirIndexPhysTagCacheModel(logNumRows, logBlockSize, associativity);
+    if (kind == "vv")
+        return new LruVirIndexVirTagCacheModel(logNumRows, logBlockSize, associativity);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,61 @@
+// Registers read and written by each instruction, shared by regDeps and the
+// CPI model. Include it after pin.H.
+//
+// The lists are collected once at instrumentation time so analysis routines
+// don't have to. Traces are instrumented again after every region change (see
+// sim_regions.h), so each instruction's lists are made once, kept by address
+// and reused. Code at an address is assumed not to change.
+#ifndef INS_REGS_H
+#define INS_REGS_H
+
+#include <map>
+
+// Upper bound on the unique registers recorded per instruction
+#define MAX_REGS_PER_INS 16
+
+struct InsRegs {
+	UINT32 numReads;
+	UINT32 numWrites;
+	REG reads[MAX_REGS_PER_INS];
+	REG writes[MAX_REGS_PER_INS];
+};
+
+static std::map<ADDRINT, InsRegs*> insRegsCache;
+
+// Adds reg to the list if it is valid and not already there. With
+// fullRegistersOnly, partial registers are recorded as their full register.
+// With skipInstPtr, the instruction pointer is left out, for models where
+// control flow does not order instructions.
+static VOID addUniqueReg(REG reg, REG *regs, UINT32 *count, BOOL fullRegistersOnly, BOOL skipInstPtr) {
+	if (fullRegistersOnly)
+		reg = REG_FullRegName(reg);
+	if (!REG_valid(reg) || *count == MAX_REGS_PER_INS)
+		return;
+	if (skipInstPtr && reg == REG_INST_PTR)
+		return;
+
+	// Don't record the same register more than once per instruction
+	for (UINT32 i = 0; i < *count; i++)
+		if (regs[i] == reg)
+			return;
+	regs[(*count)++] = reg;
+}
+
+// Returns the register lists of ins, collecting them the first time its
+// address is seen. A tool must pass the same options on every call.
+static InsRegs *getInsRegs(INS ins, BOOL fullRegistersOnly, BOOL skipInstPtr) {
+	InsRegs *&regs = insRegsCache[INS_Address(ins)];
+	if (regs)
+		return regs;
+
+	regs = new InsRegs;
+	regs->numReads = 0;
+	regs->numWrites = 0;
+	for (UINT32 i = 0; i < INS_MaxNumRRegs(ins); i++)
+		addUniqueReg(INS_RegR(ins, i), regs->reads, &regs->numReads, fullRegistersOnly, skipInstPtr);
+	for (UINT32 j = 0; j < INS_MaxNumWRegs(ins); j++)
+		addUniqueReg(INS_RegW(ins, j), regs->writes, &regs->numWrites, fullRegistersOnly, skipInstPtr);
+	return regs;
+}
+
+#endif
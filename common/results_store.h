@@ -0,0 +1,219 @@
+// Writer for the binary columnar results store shared by the pintools.
+// Include it after pin.H and sim_regions.h. resultsdb.py in this directory
+// reads and queries it.
+//
+// A store is a file of segments, each appended with a single write() under an
+// exclusive flock() so tools running side by side can share one file and
+// resultsdb.py can compact it safely. A segment holds a small table:
+//
+//   header  "EC5R", version (u16), column count (u16), row count (u32),
+//           bytes after the header (u32)
+//   columns for each: type (u8), name length (u8), name
+//   data    for each column, in order:
+//           UINT64  row count x u64
+//           DOUBLE  row count x f64
+//           STRING  row count x u32 lengths, then the bytes
+//           ARRAY   row count x u32 lengths, then the u64 values
+//
+// All values are little endian. Tools build a ResultsTable a row at a time,
+// starting each row with resultsAddRow(), and call append(); rows that never
+// set a column get 0, "" or an empty array. A column keeps the type it was
+// first set with.
+#ifndef RESULTS_STORE_H
+#define RESULTS_STORE_H
+
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+
+#define RESULTS_MAGIC "EC5R"
+#define RESULTS_VERSION 1
+
+enum RESULTS_TYPE {
+	RESULTS_UINT64 = 0,
+	RESULTS_DOUBLE,
+	RESULTS_STRING,
+	RESULTS_ARRAY
+};
+
+// This knob sets the results store to append to instead of writing the text output
+KNOB<string> KnobResultsStore(KNOB_MODE_WRITEONCE, "pintool", "db", "", "specify a results store to append to instead of writing the text output file");
+
+// This knob names the benchmark in the results store
+KNOB<string> KnobBenchmark(KNOB_MODE_WRITEONCE, "pintool", "bench", "", "specify the benchmark name for the results store (defaults to the application name)");
+
+class ResultsTable {
+	public:
+	ResultsTable() : rows(0) {}
+
+	// Starts a new row. The set functions fill in the newest row.
+	VOID addRow() {
+		rows++;
+	}
+
+	VOID setUint(const string &name, UINT64 value) {
+		column(name, RESULTS_UINT64).uints[rows - 1] = value;
+	}
+
+	VOID setDouble(const string &name, double value) {
+		column(name, RESULTS_DOUBLE).doubles[rows - 1] = value;
+	}
+
+	VOID setString(const string &name, const string &value) {
+		column(name, RESULTS_STRING).strings[rows - 1] = value;
+	}
+
+	VOID setArray(const string &name, const UINT64 *values, UINT32 count) {
+		column(name, RESULTS_ARRAY).arrays[rows - 1].assign(values, values + count);
+	}
+
+	// Appends the table to the store at path as one segment. Returns false if
+	// the file could not be written.
+	BOOL append(const string &path) {
+		if (rows == 0)
+			return TRUE;
+
+		string buffer;
+		for (UINT32 c = 0; c < columns.size(); c++) {
+			Column &col = columns[c];
+			col.resize(rows);
+			put8(buffer, col.type);
+			put8(buffer, col.name.size());
+			buffer += col.name;
+		}
+		for (UINT32 c = 0; c < columns.size(); c++)
+			putColumn(buffer, columns[c]);
+
+		string header(RESULTS_MAGIC);
+		put16(header, RESULTS_VERSION);
+		put16(header, columns.size());
+		put32(header, rows);
+		put32(header, buffer.size());
+		buffer.insert(0, header);
+
+		// Compacting replaces the file while holding the lock, so if the file
+		// was replaced while we waited, append to the new one instead
+		for (;;) {
+			int fd = open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+			if (fd < 0)
+				return FALSE;
+			struct stat opened, current;
+			if (flock(fd, LOCK_EX) != 0 || fstat(fd, &opened) != 0) {
+				close(fd);
+				return FALSE;
+			}
+			if (stat(path.c_str(), &current) != 0 || current.st_ino != opened.st_ino || current.st_dev != opened.st_dev) {
+				close(fd);
+				continue;
+			}
+
+			BOOL written = write(fd, buffer.data(), buffer.size()) == (ssize_t)buffer.size();
+			close(fd);
+			return written;
+		}
+	}
+
+	private:
+	struct Column {
+		string name;
+		UINT8 type;
+		std::vector<UINT64> uints;
+		std::vector<double> doubles;
+		std::vector<string> strings;
+		std::vector<std::vector<UINT64> > arrays;
+
+		VOID resize(UINT32 rows) {
+			if (type == RESULTS_UINT64)
+				uints.resize(rows);
+			else if (type == RESULTS_DOUBLE)
+				doubles.resize(rows);
+			else if (type == RESULTS_STRING)
+				strings.resize(rows);
+			else
+				arrays.resize(rows);
+		}
+	};
+
+	// Finds or creates a column, sized to the current row count. Setting an
+	// existing column with a different type is a bug in the tool.
+	Column &column(const string &name, UINT8 type) {
+		assert(rows > 0);
+		UINT32 c;
+		for (c = 0; c < columns.size(); c++)
+			if (columns[c].name == name)
+				break;
+		assert(c == columns.size() || columns[c].type == type);
+		if (c == columns.size()) {
+			columns.push_back(Column());
+			columns[c].name = name;
+			columns[c].type = type;
+		}
+		columns[c].resize(rows);
+		return columns[c];
+	}
+
+	static VOID putBytes(string &buffer, const VOID *data, UINT32 size) {
+		buffer.append((const char*)data, size);
+	}
+	static VOID put8(string &buffer, UINT8 value) { putBytes(buffer, &value, 1); }
+	static VOID put16(string &buffer, UINT16 value) { putBytes(buffer, &value, 2); }
+	static VOID put32(string &buffer, UINT32 value) { putBytes(buffer, &value, 4); }
+
+	VOID putColumn(string &buffer, const Column &col) {
+		if (col.type == RESULTS_UINT64) {
+			putBytes(buffer, &col.uints[0], rows * sizeof(UINT64));
+		} else if (col.type == RESULTS_DOUBLE) {
+			putBytes(buffer, &col.doubles[0], rows * sizeof(double));
+		} else if (col.type == RESULTS_STRING) {
+			for (UINT32 r = 0; r < rows; r++)
+				put32(buffer, col.strings[r].size());
+			for (UINT32 r = 0; r < rows; r++)
+				buffer += col.strings[r];
+		} else {
+			for (UINT32 r = 0; r < rows; r++)
+				put32(buffer, col.arrays[r].size());
+			for (UINT32 r = 0; r < rows; r++)
+				if (!col.arrays[r].empty())
+					putBytes(buffer, &col.arrays[r][0], col.arrays[r].size() * sizeof(UINT64));
+		}
+	}
+
+	UINT32 rows;
+	std::vector<Column> columns;
+};
+
+// The benchmark name to store: -bench, or else the file name of the
+// application after "--" on the pin command line
+static inline string resultsBenchmark(int argc, char *argv[]) {
+	if (!KnobBenchmark.Value().empty())
+		return KnobBenchmark.Value();
+
+	for (int i = 1; i < argc - 1; i++) {
+		if (strcmp(argv[i], "--") == 0) {
+			string app(argv[i + 1]);
+			size_t slash = app.rfind('/');
+			return slash == string::npos ? app : app.substr(slash + 1);
+		}
+	}
+	return "";
+}
+
+// Starts a row for tool with the columns every tool shares: the benchmark
+// name and the simulation region knobs, so sampled and whole program runs
+// can be told apart
+static inline VOID resultsAddRow(ResultsTable &table, const string &tool, const string &benchmark) {
+	table.addRow();
+	table.setString("tool", tool);
+	table.setString("benchmark", benchmark);
+	table.setUint("ff", KnobFastForward.Value());
+	table.setUint("warmup", KnobWarmup.Value());
+	table.setUint("detail", KnobDetail.Value());
+	table.setUint("period", KnobPeriod.Value());
+}
+
+#endif
@@ -0,0 +1,337 @@
+#!/usr/bin/python3
+"""Reader and query tool for the binary results store written by the pintools
+(see results_store.h for the file format).
+
+    ./resultsdb.py info results.rdb
+    ./resultsdb.py query results.rdb --where tool=caches --where a=2 \\
+        --group-by benchmark --agg sum:readHits --agg sum:readReqs
+    ./resultsdb.py compact results.rdb
+
+As a library:
+
+    from resultsdb import ResultsDB
+    db = ResultsDB('results.rdb')
+    for row in db.rows(tool='caches', benchmark='fft'):
+        ...
+    table = db.columns(tool='caches')     # {column: [values]}
+
+The reader keeps an index of segment offsets, sizes and (tool, benchmark)
+next to the store in <store>.idx, with a checksum of the indexed bytes so an
+index left behind by a deleted or replaced store is rebuilt instead of
+trusted. Only segments appended since the last index update are scanned, and
+filters on tool or benchmark skip non-matching segments without decoding
+them. compact rewrites the store with one segment per tool, which turns each
+tool's results into true columns. It holds the same flock() the tools take to
+append, so no results are lost to a tool finishing during the rewrite.
+"""
+import argparse
+import array
+import fcntl
+import json
+import os
+import struct
+import sys
+import zlib
+from collections import defaultdict
+
+MAGIC = b'EC5R'
+VERSION = 1
+HEADER = struct.Struct('<4sHHII')
+
+UINT64, DOUBLE, STRING, ARRAY = range(4)
+TYPE_NAMES = ('uint64', 'double', 'string', 'array')
+
+
+def _decode_segment(data, offset):
+    """Decodes the segment at offset. Returns ({column: [values]}, {column: type})."""
+    magic, version, ncols, nrows, length = HEADER.unpack_from(data, offset)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError(f'Not a results segment at offset {offset}')
+    pos = offset + HEADER.size
+
+    directory = []
+    for _ in range(ncols):
+        col_type, name_len = data[pos], data[pos + 1]
+        name = data[pos + 2:pos + 2 + name_len].decode()
+        directory.append((name, col_type))
+        pos += 2 + name_len
+
+    columns = {}
+    for name, col_type in directory:
+        if col_type in (UINT64, DOUBLE):
+            values = array.array('Q' if col_type == UINT64 else 'd')
+            values.frombytes(data[pos:pos + 8 * nrows])
+            columns[name] = values.tolist()
+            pos += 8 * nrows
+            continue
+
+        lengths = array.array('I')
+        lengths.frombytes(data[pos:pos + 4 * nrows])
+        pos += 4 * nrows
+        values = []
+        for n in lengths:
+            if col_type == STRING:
+                values.append(data[pos:pos + n].decode())
+                pos += n
+            else:
+                histogram = array.array('Q')
+                histogram.frombytes(data[pos:pos + 8 * n])
+                values.append(histogram.tolist())
+                pos += 8 * n
+        columns[name] = values
+
+    return columns, dict(directory)
+
+
+def _encode_segment(columns, types):
+    """Encodes {column: [values]} as one segment."""
+    nrows = len(next(iter(columns.values()))) if columns else 0
+    directory = bytearray()
+    body = bytearray()
+    for name, values in columns.items():
+        col_type = types[name]
+        encoded = name.encode()
+        directory += bytes((col_type, len(encoded))) + encoded
+        if col_type in (UINT64, DOUBLE):
+            body += array.array('Q' if col_type == UINT64 else 'd', values).tobytes()
+        elif col_type == STRING:
+            encoded_values = [v.encode() for v in values]
+            body += array.array('I', [len(v) for v in encoded_values]).tobytes()
+            body += b''.join(encoded_values)
+        else:
+            body += array.array('I', [len(v) for v in values]).tobytes()
+            for v in values:
+                body += array.array('Q', v).tobytes()
+    payload = directory + body
+    return HEADER.pack(MAGIC, VERSION, len(columns), nrows, len(payload)) + payload
+
+
+def _default(col_type):
+    return {UINT64: 0, DOUBLE: 0.0, STRING: '', ARRAY: []}[col_type]
+
+
+class ResultsDB:
+    def __init__(self, path):
+        self.path = path
+        self.index_path = path + '.idx'
+        with open(path, 'rb') as f:
+            self.data = f.read()
+        self.segments = self._load_index()
+
+    def _load_index(self):
+        """Returns [{offset, rows, tools, benchmarks}] for every segment, scanning
+        only what was appended since the index was last written."""
+        segments = []
+        indexed_size = 0
+        index_valid = False
+        if os.path.exists(self.index_path):
+            try:
+                with open(self.index_path) as f:
+                    index = json.load(f)
+                size = index['size']
+                index_valid = (size <= len(self.data) and
+                               index['crc'] == zlib.crc32(memoryview(self.data)[:size]))
+            except (ValueError, KeyError, TypeError):
+                pass
+            if index_valid:
+                segments = index['segments']
+                indexed_size = size
+
+        offset = indexed_size
+        while offset + HEADER.size <= len(self.data):
+            _, _, _, nrows, length = HEADER.unpack_from(self.data, offset)
+            end = offset + HEADER.size + length
+            if end > len(self.data):
+                # A tool is still writing this segment
+                break
+            columns, _ = _decode_segment(self.data, offset)
+            segments.append({'offset': offset, 'rows': nrows,
+                             'tools': sorted(set(columns.get('tool', ['']))),
+                             'benchmarks': sorted(set(columns.get('benchmark', [''])))})
+            offset = end
+
+        if offset != indexed_size or not index_valid:
+            with open(self.index_path, 'w') as f:
+                json.dump({'size': offset, 'crc': zlib.crc32(memoryview(self.data)[:offset]),
+                           'segments': segments}, f)
+        return segments
+
+    def _matching_segments(self, tool, benchmark):
+        for segment in self.segments:
+            if tool is not None and tool not in segment['tools']:
+                continue
+            if benchmark is not None and benchmark not in segment['benchmarks']:
+                continue
+            yield segment
+
+    def columns(self, tool=None, benchmark=None, where=None):
+        """Returns ({column: [values]}, {column: type}) for the matching rows.
+        Columns missing from a segment are filled with 0, '' or [], and only
+        match a filter for ''."""
+        filters = dict(where or {})
+        if tool is not None:
+            filters['tool'] = tool
+        if benchmark is not None:
+            filters['benchmark'] = benchmark
+
+        result = {}
+        types = {}
+        total = 0
+        for segment in self._matching_segments(tool, benchmark):
+            columns, segment_types = _decode_segment(self.data, segment['offset'])
+            keep = range(segment['rows'])
+            for name, value in filters.items():
+                if name not in columns:
+                    if value != '':
+                        keep = []
+                        break
+                    continue
+                values = columns[name]
+                keep = [r for r in keep if _matches(values[r], value)]
+            if not keep:
+                continue
+
+            for name, col_type in segment_types.items():
+                if name not in result:
+                    result[name] = [_default(col_type)] * total
+                    types[name] = col_type
+            for name, values in result.items():
+                if name in columns:
+                    source = columns[name]
+                    values.extend(source[r] for r in keep)
+                else:
+                    values.extend([_default(types[name])] * len(keep))
+            total += len(keep)
+        return result, types
+
+    def rows(self, tool=None, benchmark=None, where=None):
+        """Yields each matching row as a dict."""
+        columns, _ = self.columns(tool, benchmark, where)
+        names = list(columns)
+        for values in zip(*(columns[n] for n in names)):
+            yield dict(zip(names, values))
+
+    def compact(self):
+        """Rewrites the store with one segment per tool. Rows without a tool
+        column are kept together in their own segment."""
+        with open(self.path, 'rb') as store:
+            # Tools append under this lock, so the store can't grow until it
+            # has been replaced. Tools that were waiting append to the new file.
+            fcntl.flock(store, fcntl.LOCK_EX)
+            self.__init__(self.path)
+
+            tools = sorted({t for s in self.segments for t in s['tools']})
+            segments = [_encode_segment(*self.columns(tool=t)) for t in tools]
+            tmp_path = self.path + '.tmp'
+            with open(tmp_path, 'wb') as f:
+                for segment in segments:
+                    f.write(segment)
+            os.replace(tmp_path, self.path)
+            if os.path.exists(self.index_path):
+                os.remove(self.index_path)
+        self.__init__(self.path)
+
+
+def _matches(value, wanted):
+    """Compares a stored value with a filter value given as a string."""
+    if isinstance(wanted, str) and not isinstance(value, str):
+        try:
+            wanted = type(value)(wanted)
+        except ValueError:
+            return False
+    return value == wanted
+
+
+def _aggregate(func, values):
+    if func == 'sum':
+        return sum(values)
+    if func == 'mean':
+        return sum(values) / len(values) if values else 0
+    if func == 'min':
+        return min(values)
+    if func == 'max':
+        return max(values)
+    if func == 'count':
+        return len(values)
+    raise ValueError(f'Unknown aggregate {func}')
+
+
+def _print_table(header, rows):
+    cells = [[str(c) for c in header]] + [[_format(c) for c in row] for row in rows]
+    widths = [max(len(row[i]) for row in cells) for i in range(len(header))]
+    for row in cells:
+        print('  '.join(c.ljust(w) for c, w in zip(row, widths)).rstrip())
+
+
+def _format(value):
+    if isinstance(value, float):
+        return f'{value:0.6g}'
+    if isinstance(value, list):
+        return ','.join(str(v) for v in value)
+    return str(value)
+
+
+def _query(db, opts):
+    where = dict(w.split('=', 1) for w in opts.where)
+    tool = where.pop('tool', None)
+    benchmark = where.pop('benchmark', None)
+    columns, _ = db.columns(tool, benchmark, where)
+    nrows = len(next(iter(columns.values()))) if columns else 0
+
+    if not opts.agg:
+        names = opts.columns.split(',') if opts.columns else list(columns)
+        _print_table(names, zip(*(columns.get(n, [''] * nrows) for n in names)))
+        return
+
+    group_by = opts.group_by.split(',') if opts.group_by else []
+    aggs = [a.split(':', 1) if ':' in a else (a, None) for a in opts.agg]
+    groups = defaultdict(list)
+    for r in range(nrows):
+        groups[tuple(columns[g][r] for g in group_by)].append(r)
+
+    rows = []
+    for key in sorted(groups):
+        members = groups[key]
+        rows.append(list(key) + [_aggregate(func, [columns[col][r] for r in members] if col else members)
+                                 for func, col in aggs])
+    _print_table(group_by + [f'{f}({c})' if c else f for f, c in aggs], rows)
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest='command', required=True)
+
+    info = commands.add_parser('info', help='summarise the segments and columns in a store')
+    info.add_argument('store')
+
+    query = commands.add_parser('query', help='filter, print and aggregate rows')
+    query.add_argument('store')
+    query.add_argument('--where', action='append', default=[], metavar='COLUMN=VALUE',
+                       help='keep rows where a column equals a value (repeatable)')
+    query.add_argument('--columns', help='comma separated columns to print')
+    query.add_argument('--group-by', help='comma separated columns to group by')
+    query.add_argument('--agg', action='append', default=[], metavar='FUNC:COLUMN',
+                       help='sum, mean, min, max or count of a column per group (repeatable)')
+
+    compact = commands.add_parser('compact', help='rewrite the store with one segment per tool')
+    compact.add_argument('store')
+
+    opts = parser.parse_args()
+    db = ResultsDB(opts.store)
+
+    if opts.command == 'info':
+        rows = sum(s['rows'] for s in db.segments)
+        print(f'{opts.store}: {len(db.segments)} segments, {rows} rows')
+        for tool in sorted({t for s in db.segments for t in s['tools']}):
+            columns, types = db.columns(tool=tool)
+            count = len(next(iter(columns.values()), []))
+            print(f'\t{tool or "<no tool>"}: {count} rows')
+            for name, col_type in types.items():
+                print(f'\t\t{name} ({TYPE_NAMES[col_type]})')
+    elif opts.command == 'query':
+        _query(db, opts)
+    else:
+        db.compact()
+        print(f'Compacted {opts.store} into {len(db.segments)} segments')
+    sys.exit()
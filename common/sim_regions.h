@@ -0,0 +1,162 @@
+// Fast-forward, warm-up and detailed simulation regions, shared by the
+// pintools. Include it after pin.H and call initRegions() after PIN_Init.
+//
+// The run is split into phases by instruction count:
+//   fast-forward - only a per-block counter is inserted
+//   warm-up      - the tool's full instrumentation runs but records nothing
+//   detail       - the tool's full instrumentation runs and records results
+// With -period, the fast-forward/warm-up/detail cycle repeats every -period
+// instructions (SMARTS-style sampling). With every knob at 0 the whole program
+// is simulated in detail and nothing extra is inserted.
+//
+// Tools skip inserting their instrumentation when regionsInstrument() is
+// false, and only update statistics when regionsRecord() is true. Switching
+// between instrumented and uninstrumented phases flushes the code cache with
+// PIN_RemoveInstrumentation so every trace is re-instrumented for the new
+// phase. Tools should reuse any data they allocate per instruction at
+// instrumentation time, or memory grows with every switch.
+//
+// The instruction count is shared by all threads, so with threaded
+// applications phase boundaries are approximate.
+#ifndef SIM_REGIONS_H
+#define SIM_REGIONS_H
+
+KNOB<UINT64> KnobFastForward(KNOB_MODE_WRITEONCE, "pintool", "ff", "0", "specify the instructions to fast-forward before simulating");
+KNOB<UINT64> KnobWarmup(KNOB_MODE_WRITEONCE, "pintool", "warmup", "0", "specify the instructions to warm up state for without recording results");
+KNOB<UINT64> KnobDetail(KNOB_MODE_WRITEONCE, "pintool", "detail", "0", "specify the instructions to simulate in detail (0 runs to the end)");
+KNOB<UINT64> KnobPeriod(KNOB_MODE_WRITEONCE, "pintool", "period", "0", "specify the instructions between the starts of repeated regions (0 runs one region)");
+
+enum SIM_PHASE {
+	PHASE_FASTFORWARD = 0,
+	PHASE_WARMUP,
+	PHASE_DETAIL,
+	PHASE_DONE
+};
+
+static SIM_PHASE simPhase = PHASE_DETAIL;
+
+// Instructions executed so far, and the count the current phase ends at
+static UINT64 regionInsCount = 0;
+static UINT64 phaseEnd = ~0ULL;
+
+// Set once the first fast-forward is over
+static BOOL regionStarted = FALSE;
+
+static PIN_LOCK regionLock;
+
+// Whether tools should insert their instrumentation
+static inline BOOL regionsInstrument() {
+	return simPhase == PHASE_WARMUP || simPhase == PHASE_DETAIL;
+}
+
+// Whether tools should record results
+static inline BOOL regionsRecord() {
+	return simPhase == PHASE_DETAIL;
+}
+
+// Length of a phase in instructions. A phase of length 0 is skipped.
+static UINT64 phaseLength(SIM_PHASE phase) {
+	UINT64 period = KnobPeriod.Value();
+	UINT64 region = KnobWarmup.Value() + KnobDetail.Value();
+	switch (phase) {
+		case PHASE_FASTFORWARD:
+			// After the first region, fast-forward to the start of the next period
+			if (!regionStarted)
+				return KnobFastForward.Value();
+			return period > region ? period - region : 0;
+		case PHASE_WARMUP:
+			return KnobWarmup.Value();
+		case PHASE_DETAIL:
+			return KnobDetail.Value();
+		default:
+			return 0;
+	}
+}
+
+// Whether a phase lasts until the program exits
+static inline BOOL phaseUnbounded(SIM_PHASE phase) {
+	return phase == PHASE_DONE || (phase == PHASE_DETAIL && KnobDetail.Value() == 0);
+}
+
+// Moves to the next phase with a non-zero length, starting at instruction start
+static VOID advancePhase(UINT64 start) {
+	do {
+		switch (simPhase) {
+			case PHASE_FASTFORWARD:
+				simPhase = PHASE_WARMUP;
+				regionStarted = TRUE;
+				break;
+			case PHASE_WARMUP:
+				simPhase = PHASE_DETAIL;
+				break;
+			case PHASE_DETAIL:
+				simPhase = KnobPeriod.Value() ? PHASE_FASTFORWARD : PHASE_DONE;
+				break;
+			default:
+				return;
+		}
+	} while (phaseLength(simPhase) == 0 && !phaseUnbounded(simPhase));
+
+	phaseEnd = phaseUnbounded(simPhase) ? ~0ULL : start + phaseLength(simPhase);
+}
+
+// Counts a basic block. Returns true when the block starts past the end of
+// the current phase.
+static ADDRINT PIN_FAST_ANALYSIS_CALL countRegionBlock(UINT32 numIns) {
+	regionInsCount += numIns;
+	return regionInsCount > phaseEnd;
+}
+
+// Called when a phase ends, before the block that ended it executes. The
+// block is the first one of the next phase.
+static VOID endPhase(UINT32 numIns, CONTEXT *ctxt) {
+	PIN_GetLock(&regionLock, PIN_ThreadId() + 1);
+	// Another thread may have already moved to the next phase
+	if (regionInsCount <= phaseEnd) {
+		PIN_ReleaseLock(&regionLock);
+		return;
+	}
+
+	BOOL wasInstrumented = regionsInstrument();
+	advancePhase(regionInsCount - numIns);
+	BOOL instrumentationChanged = wasInstrumented != regionsInstrument();
+	if (instrumentationChanged) {
+		// The block is counted again when it re-runs with the new instrumentation
+		regionInsCount -= numIns;
+	}
+	PIN_ReleaseLock(&regionLock);
+
+	if (instrumentationChanged) {
+		PIN_RemoveInstrumentation();
+		PIN_ExecuteAt(ctxt);
+	}
+}
+
+static VOID regionsTrace(TRACE trace, VOID *v) {
+	// No phase change is coming, so the counter is not needed
+	if (phaseUnbounded(simPhase))
+		return;
+
+	for (BBL bbl = TRACE_BblHead(trace); BBL_Valid(bbl); bbl = BBL_Next(bbl)) {
+		BBL_InsertIfCall(bbl, IPOINT_BEFORE, (AFUNPTR)countRegionBlock, IARG_FAST_ANALYSIS_CALL,
+						 IARG_UINT32, BBL_NumIns(bbl), IARG_END);
+		BBL_InsertThenCall(bbl, IPOINT_BEFORE, (AFUNPTR)endPhase,
+						   IARG_UINT32, BBL_NumIns(bbl), IARG_CONTEXT, IARG_END);
+	}
+}
+
+// Sets up the first phase from the knobs. Call after PIN_Init.
+static VOID initRegions() {
+	if (!KnobFastForward.Value() && !KnobWarmup.Value() && !KnobDetail.Value() && !KnobPeriod.Value())
+		return;
+
+	PIN_InitLock(&regionLock);
+	simPhase = PHASE_FASTFORWARD;
+	phaseEnd = KnobFastForward.Value();
+	if (phaseEnd == 0)
+		advancePhase(0);
+
+	TRACE_AddInstrumentFunction(regionsTrace, 0);
+}
+
+#endif
@@ -0,0 +1,397 @@
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <assert.h>
+#include "pin.H"
+#include "sim_regions.h"
+#include "results_store.h"
+#include "branch_predictors.h"
+#include "cache_models.h"
+#include "ins_regs.h"
+
+// A single pintool that runs the register dependency (lab 1), branch
+// prediction (lab 2) and cache (lab 3) analyses from one instrumentation pass,
+// and feeds their events into a first-order interval model of an
+// out-of-order core to estimate CPI and a breakdown of where cycles go.
+//
+// The model charges:
+//   base       - one cycle per issue group of `width` instructions
+//   dependency - one extra cycle for every issue group that contains a
+//                consumer of a register written earlier in the same group
+//   branch     - the mispredict penalty for every mispredicted branch
+//   l2         - the L2 latency for L1 load misses that hit in the L2
+//   memory     - the memory latency for L2 load misses
+// Stores update the caches but retire through the store buffer, so their
+// misses do not stall the core and are not charged. A miss that starts within
+// `rob` instructions of the previous miss of the same kind overlaps with it
+// and is not charged again (memory level parallelism inside the reorder
+// buffer). Branches are charged through the predictor only, so the
+// instruction pointer is not treated as a register dependency.
+
+// This knob sets the output file name
+KNOB<string> KnobOutputFile(KNOB_MODE_WRITEONCE, "pintool", "o", "cpi.out", "specify the output file name");
+
+// This knob will set the maximum spacing between two dependant instructions in the program
+KNOB<UINT32> KnobMaxSpacing(KNOB_MODE_WRITEONCE, "pintool", "s", "100", "specify the maximum spacing between two dependant instructions in the program");
+
+// Core model knobs
+KNOB<UINT32> KnobIssueWidth(KNOB_MODE_WRITEONCE, "pintool", "w", "4", "specify the issue width of the core");
+KNOB<UINT32> KnobRobSize(KNOB_MODE_WRITEONCE, "pintool", "rob", "128", "specify the number of reorder buffer entries");
+KNOB<UINT32> KnobMispredictPenalty(KNOB_MODE_WRITEONCE, "pintool", "bp", "15", "specify the branch mispredict penalty in cycles");
+KNOB<UINT32> KnobL2Latency(KNOB_MODE_WRITEONCE, "pintool", "l2lat", "12", "specify the latency of an L1 miss that hits in the L2");
+KNOB<UINT32> KnobMemLatency(KNOB_MODE_WRITEONCE, "pintool", "memlat", "200", "specify the latency of an L2 miss");
+
+// Cache knobs, using the same log2 parameters and models as the lab 3 cache tool
+KNOB<UINT32> KnobLogPhysicalMemSize(KNOB_MODE_WRITEONCE, "pintool", "m", "16", "specify the log of physical memory size in bytes");
+KNOB<UINT32> KnobLogPageSize(KNOB_MODE_WRITEONCE, "pintool", "p", "12", "specify the log of page size in bytes");
+KNOB<string> KnobL1Model(KNOB_MODE_WRITEONCE, "pintool", "l1m", "vp", "specify the L1 cache model: pp, vp or vv (physical/virtual index and tag)");
+KNOB<string> KnobL2Model(KNOB_MODE_WRITEONCE, "pintool", "l2m", "pp", "specify the L2 cache model: pp, vp or vv (physical/virtual index and tag)");
+KNOB<UINT32> KnobL1LogNumRows(KNOB_MODE_WRITEONCE, "pintool", "l1r", "6", "specify the log of number of rows in the L1 cache");
+KNOB<UINT32> KnobL1LogBlockSize(KNOB_MODE_WRITEONCE, "pintool", "l1b", "6", "specify the log of block size of the L1 cache in bytes");
+KNOB<UINT32> KnobL1Associativity(KNOB_MODE_WRITEONCE, "pintool", "l1a", "8", "specify the associativity of the L1 cache");
+KNOB<UINT32> KnobL2LogNumRows(KNOB_MODE_WRITEONCE, "pintool", "l2r", "10", "specify the log of number of rows in the L2 cache");
+KNOB<UINT32> KnobL2LogBlockSize(KNOB_MODE_WRITEONCE, "pintool", "l2b", "6", "specify the log of block size of the L2 cache in bytes");
+KNOB<UINT32> KnobL2Associativity(KNOB_MODE_WRITEONCE, "pintool", "l2a", "8", "specify the associativity of the L2 cache");
+
+static UINT32 issueWidth;
+static UINT32 robSize;
+
+// Benchmark name for the results store
+static string benchmarkName;
+
+/* ===================================================================== */
+/* Program totals                                                        */
+/* ===================================================================== */
+
+// Instructions executed while recording results, which the CPI is over
+static UINT64 recordedInstructions = 0;
+
+// The array storing the spacing frequency between two dependant instructions
+static UINT64 *dependancySpacing;
+static UINT32 maxSize;
+
+static UINT64 branches = 0;
+static UINT64 mispredicts = 0;
+static UINT64 l1Requests = 0;
+static UINT64 l1Hits = 0;
+static UINT64 l2Requests = 0;
+static UINT64 l2Hits = 0;
+
+static UINT64 dependencyCycles = 0;
+static UINT64 branchCycles = 0;
+static UINT64 l2Cycles = 0;
+static UINT64 memoryCycles = 0;
+
+/* ===================================================================== */
+/* Per-thread core model                                                 */
+/* ===================================================================== */
+
+// Each thread is modelled as its own core, with its own issue groups,
+// register writers, predictor and caches, so threads don't see each other's
+// dependencies or misses. Its counters are added to the totals when it exits,
+// which makes the CPI an average over the cores.
+struct ThreadData {
+	// Instructions executed by this thread
+	UINT64 ins_count;
+	// Instruction count of the last write to each register, indexed by REG
+	UINT64 last_reg_write[REG_LAST];
+	// Issue group of the last dependency stall, so a group is only split once
+	UINT64 lastStalledGroup;
+	UINT64 recordedInstructions;
+	UINT64 *spacing;
+
+	// Lab 2's combining predictor, and one lab 3 cache model per level
+	BranchPredictor *BP;
+	UINT64 branches;
+	UINT64 mispredicts;
+	CacheModel *L1;
+	CacheModel *L2;
+
+	UINT64 dependencyCycles;
+	UINT64 branchCycles;
+	UINT64 l2Cycles;
+	UINT64 memoryCycles;
+
+	// Instruction that started the last charged miss at each level. A miss
+	// within the reorder buffer of it overlaps and is not charged again.
+	UINT64 lastL2Miss;
+	UINT64 lastMemMiss;
+	BOOL seenL2Miss;
+	BOOL seenMemMiss;
+};
+
+static TLS_KEY tlsKey;
+
+// Tool register holding the current thread's ThreadData, so analysis
+// routines get it without a TLS lookup.
+static REG scratchReg;
+
+static PIN_LOCK totalsLock;
+
+// Called before every instruction with its precomputed register lists.
+// Reads are handled before writes so an instruction never depends on itself.
+VOID PIN_FAST_ANALYSIS_CALL recordInstruction(ThreadData *tdata, InsRegs *regs)
+{
+	UINT64 ins_count = ++tdata->ins_count;
+	UINT64 group = ins_count / issueWidth;
+	BOOL record = regionsRecord();
+	if (record)
+		tdata->recordedInstructions++;
+
+	for (UINT32 i = 0; i < regs->numReads; i++) {
+		UINT64 producer = tdata->last_reg_write[regs->reads[i]];
+		UINT64 spacing = ins_count - producer;
+		if (spacing < maxSize && record)
+			tdata->spacing[spacing]++;
+
+		// A consumer in the same issue group as its producer splits the group
+		if (producer != 0 && producer / issueWidth == group && tdata->lastStalledGroup != group) {
+			tdata->lastStalledGroup = group;
+			if (record)
+				tdata->dependencyCycles++;
+		}
+	}
+
+	for (UINT32 i = 0; i < regs->numWrites; i++)
+		tdata->last_reg_write[regs->writes[i]] = ins_count;
+}
+
+VOID PIN_FAST_ANALYSIS_CALL cacheLoad(ThreadData *tdata, ADDRINT addr)
+{
+	// Aligned to a word boundary, as the lab 3 cache tool does
+	UINT32 virtualAddr = ((UINT32)addr >> 2) << 2;
+	if (tdata->L1->readReq(virtualAddr))
+		return;
+
+	if (tdata->L2->readReq(virtualAddr)) {
+		if (!tdata->seenL2Miss || tdata->ins_count - tdata->lastL2Miss >= robSize) {
+			if (regionsRecord())
+				tdata->l2Cycles += KnobL2Latency.Value();
+			tdata->lastL2Miss = tdata->ins_count;
+			tdata->seenL2Miss = TRUE;
+		}
+		return;
+	}
+
+	if (!tdata->seenMemMiss || tdata->ins_count - tdata->lastMemMiss >= robSize) {
+		if (regionsRecord())
+			tdata->memoryCycles += KnobMemLatency.Value();
+		tdata->lastMemMiss = tdata->ins_count;
+		tdata->seenMemMiss = TRUE;
+	}
+}
+
+// Stores fill both levels like loads but are never charged
+VOID PIN_FAST_ANALYSIS_CALL cacheStore(ThreadData *tdata, ADDRINT addr)
+{
+	UINT32 virtualAddr = ((UINT32)addr >> 2) << 2;
+	if (!tdata->L1->writeReq(virtualAddr))
+		tdata->L2->writeReq(virtualAddr);
+}
+
+VOID PIN_FAST_ANALYSIS_CALL handleBranch(ThreadData *tdata, ADDRINT ip, BOOL taken)
+{
+	BOOL prediction = tdata->BP->makePrediction(ip);
+	tdata->BP->makeUpdate(taken, prediction, ip);
+
+	// Warm-up trains the predictor without counting
+	if (!regionsRecord())
+		return;
+
+	tdata->branches++;
+	if (prediction != taken) {
+		tdata->mispredicts++;
+		tdata->branchCycles += KnobMispredictPenalty.Value();
+	}
+}
+
+// Pin calls this function every time a new instruction is encountered
+VOID Instruction(INS ins, VOID *v)
+{
+	if (!regionsInstrument())
+		return;
+
+	InsRegs *regs = getInsRegs(ins, TRUE, TRUE);
+
+	INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)recordInstruction, IARG_FAST_ANALYSIS_CALL,
+				   IARG_REG_VALUE, scratchReg, IARG_PTR, regs, IARG_END);
+
+	if (INS_IsMemoryRead(ins))
+		INS_InsertPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)cacheLoad, IARG_FAST_ANALYSIS_CALL,
+								 IARG_REG_VALUE, scratchReg, IARG_MEMORYREAD_EA, IARG_END);
+	if (INS_IsMemoryWrite(ins))
+		INS_InsertPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)cacheStore, IARG_FAST_ANALYSIS_CALL,
+								 IARG_REG_VALUE, scratchReg, IARG_MEMORYWRITE_EA, IARG_END);
+
+	if (INS_IsBranch(ins) && INS_HasFallThrough(ins))
+		INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)handleBranch, IARG_FAST_ANALYSIS_CALL,
+					   IARG_REG_VALUE, scratchReg, IARG_INST_PTR, IARG_BRANCH_TAKEN, IARG_END);
+}
+
+VOID ThreadStart(THREADID tid, CONTEXT *ctxt, INT32 flags, VOID *v)
+{
+	ThreadData *tdata = new ThreadData;
+	tdata->ins_count = 0;
+	for (UINT32 i = 0; i < REG_LAST; i++)
+		tdata->last_reg_write[i] = 0;
+	tdata->lastStalledGroup = ~0ULL;
+	tdata->recordedInstructions = 0;
+	tdata->spacing = new UINT64[maxSize]();
+
+	tdata->BP = new myBranchPredictor();
+	tdata->branches = 0;
+	tdata->mispredicts = 0;
+	tdata->L1 = newCacheModel(KnobL1Model.Value(), KnobL1LogNumRows.Value(), KnobL1LogBlockSize.Value(), KnobL1Associativity.Value());
+	tdata->L2 = newCacheModel(KnobL2Model.Value(), KnobL2LogNumRows.Value(), KnobL2LogBlockSize.Value(), KnobL2Associativity.Value());
+
+	tdata->dependencyCycles = 0;
+	tdata->branchCycles = 0;
+	tdata->l2Cycles = 0;
+	tdata->memoryCycles = 0;
+	tdata->lastL2Miss = 0;
+	tdata->lastMemMiss = 0;
+	tdata->seenL2Miss = FALSE;
+	tdata->seenMemMiss = FALSE;
+
+	PIN_SetThreadData(tlsKey, tdata, tid);
+	PIN_SetContextReg(ctxt, scratchReg, (ADDRINT)tdata);
+}
+
+// Adds the exiting thread's counters to the program totals
+VOID ThreadFini(THREADID tid, const CONTEXT *ctxt, INT32 code, VOID *v)
+{
+	ThreadData *tdata = static_cast<ThreadData*>(PIN_GetThreadData(tlsKey, tid));
+
+	PIN_GetLock(&totalsLock, tid + 1);
+	recordedInstructions += tdata->recordedInstructions;
+	for (UINT32 i = 0; i < maxSize; i++)
+		dependancySpacing[i] += tdata->spacing[i];
+	branches += tdata->branches;
+	mispredicts += tdata->mispredicts;
+	l1Requests += tdata->L1->requests();
+	l1Hits += tdata->L1->hits();
+	l2Requests += tdata->L2->requests();
+	l2Hits += tdata->L2->hits();
+	dependencyCycles += tdata->dependencyCycles;
+	branchCycles += tdata->branchCycles;
+	l2Cycles += tdata->l2Cycles;
+	memoryCycles += tdata->memoryCycles;
+	PIN_ReleaseLock(&totalsLock);
+
+	delete[] tdata->spacing;
+	delete tdata->BP;
+	delete tdata->L1;
+	delete tdata->L2;
+	delete tdata;
+}
+
+// This function is called when the application exits
+VOID Fini(INT32 code, VOID *v)
+{
+	UINT64 baseCycles = (recordedInstructions + issueWidth - 1) / issueWidth;
+	UINT64 totalCycles = baseCycles + dependencyCycles + branchCycles + l2Cycles + memoryCycles;
+	double instructions = recordedInstructions ? (double)recordedInstructions : 1.0;
+
+	if (!KnobResultsStore.Value().empty()) {
+		ResultsTable table;
+		resultsAddRow(table, "cpiModel", benchmarkName);
+		table.setUint("w", issueWidth);
+		table.setUint("rob", robSize);
+		table.setUint("bp", KnobMispredictPenalty.Value());
+		table.setUint("l2lat", KnobL2Latency.Value());
+		table.setUint("memlat", KnobMemLatency.Value());
+		table.setUint("l1r", KnobL1LogNumRows.Value());
+		table.setUint("l1b", KnobL1LogBlockSize.Value());
+		table.setUint("l1a", KnobL1Associativity.Value());
+		table.setUint("l2r", KnobL2LogNumRows.Value());
+		table.setUint("l2b", KnobL2LogBlockSize.Value());
+		table.setUint("l2a", KnobL2Associativity.Value());
+		table.setString("l1m", KnobL1Model.Value());
+		table.setString("l2m", KnobL2Model.Value());
+		table.setUint("m", logPhysicalMemSize);
+		table.setUint("p", logPageSize);
+		table.setUint("instructions", recordedInstructions);
+		table.setUint("cycles", totalCycles);
+		table.setDouble("cpi", totalCycles / instructions);
+		table.setDouble("baseCpi", baseCycles / instructions);
+		table.setDouble("dependencyCpi", dependencyCycles / instructions);
+		table.setDouble("branchCpi", branchCycles / instructions);
+		table.setDouble("l2Cpi", l2Cycles / instructions);
+		table.setDouble("memoryCpi", memoryCycles / instructions);
+		table.setUint("branches", branches);
+		table.setUint("mispredicts", mispredicts);
+		table.setUint("l1Accesses", l1Requests);
+		table.setUint("l1Hits", l1Hits);
+		table.setUint("l2Accesses", l2Requests);
+		table.setUint("l2Hits", l2Hits);
+		table.setArray("spacing", dependancySpacing, maxSize);
+		if (!table.append(KnobResultsStore.Value()))
+			cerr << "Cannot append to " << KnobResultsStore.Value() << endl;
+		return;
+	}
+
+	// Write to a file since cout and cerr maybe closed by the application
+	ofstream outfile;
+	outfile.open(KnobOutputFile.Value().c_str());
+	outfile << "instructions: " << recordedInstructions << "\n";
+	outfile << "cycles: " << totalCycles << "\n";
+	outfile << "cpi: " << totalCycles / instructions << "\n";
+	outfile << "base cpi: " << baseCycles / instructions << "\n";
+	outfile << "dependency cpi: " << dependencyCycles / instructions << "\n";
+	outfile << "branch cpi: " << branchCycles / instructions << "\n";
+	outfile << "l2 cpi: " << l2Cycles / instructions << "\n";
+	outfile << "memory cpi: " << memoryCycles / instructions << "\n";
+	outfile << "branches: " << branches << "  mispredicts: " << mispredicts << "\n";
+	outfile << "l1 accesses: " << l1Requests << "  l1 hits: " << l1Hits << "\n";
+	outfile << "l2 accesses: " << l2Requests << "  l2 hits: " << l2Hits << "\n";
+	outfile << "dependency spacing: ";
+	for (UINT32 i = 0; i < maxSize; i++)
+		outfile << dependancySpacing[i] << ",";
+	outfile << "\n";
+	outfile.close();
+}
+
+// argc, argv are the entire command line, including pin -t <toolname> -- ...
+int main(int argc, char * argv[])
+{
+	// Initialize pin
+	PIN_Init(argc, argv);
+	initRegions();
+	benchmarkName = resultsBenchmark(argc, argv);
+
+	issueWidth = KnobIssueWidth.Value() ? KnobIssueWidth.Value() : 1;
+	robSize = KnobRobSize.Value();
+	maxSize = KnobMaxSpacing.Value();
+	dependancySpacing = new UINT64[maxSize]();
+
+	logPageSize = KnobLogPageSize.Value();
+	logPhysicalMemSize = KnobLogPhysicalMemSize.Value();
+
+	if (!isCacheModel(KnobL1Model.Value()) || !isCacheModel(KnobL2Model.Value())) {
+		cerr << "Unknown cache model, expected pp, vp or vv" << endl;
+		return 1;
+	}
+
+	PIN_InitLock(&totalsLock);
+	tlsKey = PIN_CreateThreadDataKey(0);
+	scratchReg = PIN_ClaimToolRegister();
+	if (!REG_valid(scratchReg)) {
+		cerr << "Cannot allocate a scratch register" << endl;
+		return 1;
+	}
+
+	// Register Instruction to be called to instrument instructions
+	INS_AddInstrumentFunction(Instruction, 0);
+
+	PIN_AddThreadStartFunction(ThreadStart, 0);
+	PIN_AddThreadFiniFunction(ThreadFini, 0);
+
+	// Register Fini to be called when the application exits
+	PIN_AddFiniFunction(Fini, 0);
+
+	// Start the program, never returns
+	PIN_StartProgram();
+
+	return 0;
+}
@@ -2,11 +2,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <fstream>
+#include <sstream>
 #include <assert.h>
-#include <map>
 #include <vector>
-#include <set>
+#include <map>
 #include "pin.H"
+#include "sim_regions.h"
+#include "results_store.h"
+#include "ins_regs.h"
 
 ofstream OutFile;
 
@@ -14,7 +17,26 @@ ofstream OutFile;
 // Set false to look at each register individually, for question 3.
 static bool USE_FULL_REGISTERS_ONLY = true;
 
-// The array storing the spacing frequency between two dependant instructions
+// Memory dependencies are tracked per 4-byte granule of memory
+#define SHADOW_GRANULE_BITS 2
+// Bytes of application memory covered by one second-level shadow table
+#define SHADOW_CHUNK_BITS 24
+// User space addresses on x86-64 fit in 47 bits
+#define SHADOW_ADDRESS_BITS 47
+#define SHADOW_CHUNK_ENTRIES (1ULL << (SHADOW_CHUNK_BITS - SHADOW_GRANULE_BITS))
+#define SHADOW_TABLE_ENTRIES (1ULL << (SHADOW_ADDRESS_BITS - SHADOW_CHUNK_BITS))
+// Shadow entries keep the storing thread's id (plus one) in the top bits and
+// the stamp in the rest
+#define SHADOW_TID_BITS 16
+#define SHADOW_STAMP_BITS (64 - SHADOW_TID_BITS)
+#define SHADOW_STAMP_MASK ((1ULL << SHADOW_STAMP_BITS) - 1)
+#define SHADOW_MAX_THREADS ((1u << SHADOW_TID_BITS) - 1)
+
+// Memory accesses are split into size classes of 1, 2, 4, 8, 16, 32 and 64+ bytes
+#define NUM_SIZE_CLASSES 7
+
+// The array storing the spacing frequency between two dependant instructions,
+// summed over every thread when it exits
 UINT64 *dependancySpacing;
 
 // Output file name
@@ -26,95 +48,495 @@ KNOB<string> KnobOutputFile(KNOB_MODE_WRITEONCE, "pintool", "o", "result.csv", "
 // This knob will set the maximum spacing between two dependant instructions in the program
 KNOB<string> KnobMaxSpacing(KNOB_MODE_WRITEONCE, "pintool", "s", "100", "specify the maximum spacing between two dependant instructions in the program");
 
-//KNOB<string> HistoryOutputFile(KNOB_MODE_WRITEONCE, "pintool", "qqq", "history.txt", "specify the history file");
+// This knob selects register ("reg") or store-to-load memory ("mem") dependencies,
+// or the instruction window limit study ("ilp")
+KNOB<string> KnobMode(KNOB_MODE_WRITEONCE, "pintool", "mode", "reg", "specify the analysis to run: reg, mem or ilp");
+
+// This knob splits the memory dependency histogram by access size
+KNOB<BOOL> KnobSplitBySize(KNOB_MODE_WRITEONCE, "pintool", "split", "0", "in mem mode, also write one histogram per load size to <output>.size<N>");
+
+// In ilp mode, the window sizes and issue widths to schedule for. Every
+// combination is simulated in the same pass.
+KNOB<string> KnobWindowSizes(KNOB_MODE_WRITEONCE, "pintool", "windows", "32,64,128,256,0", "in ilp mode, comma separated instruction window sizes (0 is unbounded)");
+KNOB<string> KnobIssueWidths(KNOB_MODE_WRITEONCE, "pintool", "widths", "4", "in ilp mode, comma separated issue widths (0 is unbounded)");
+
+// This knob makes the ilp scheduler respect store-to-load dependencies
+KNOB<BOOL> KnobIlpMemory(KNOB_MODE_WRITEONCE, "pintool", "ilpmem", "0", "in ilp mode, also schedule loads after the stores they read");
+
+enum MODE {
+	MODE_REG,
+	MODE_MEM,
+	MODE_ILP
+};
+
+static MODE mode = MODE_REG;
+
+// Benchmark name for the results store
+static string benchmarkName;
+
+// Memory dependency histograms for each load size class, summed over every
+// thread when it exits
+UINT64 *sizeSpacing[NUM_SIZE_CLASSES];
+
+// Two-level shadow memory holding a stamp (instruction count or cycle) for
+// the last store to each granule. The first level is indexed by the upper
+// address bits and the second level tables are allocated on the first store
+// into their range. Both levels come from calloc so untouched pages are never
+// backed by memory.
+//
+// Each thread counts its own instructions and cycles, so stamps from
+// different threads can't be compared. Every entry records which thread
+// stored the granule and lookups only return stores made by the asking
+// thread.
+class ShadowMemory {
+	public:
+	ShadowMemory() {
+		table = (UINT64**)calloc(SHADOW_TABLE_ENTRIES, sizeof(UINT64*));
+		PIN_InitLock(&chunkLock);
+	}
+
+	// Returns the most recent store by thread tid to any granule in
+	// [addr, addr + size), or 0 if tid was not the last to store to any of them
+	UINT64 lastStore(ADDRINT addr, UINT32 size, THREADID tid) {
+		UINT64 owner = threadTag(tid);
+		UINT64 last = 0;
+		for (ADDRINT g = addr >> SHADOW_GRANULE_BITS; g <= (addr + size - 1) >> SHADOW_GRANULE_BITS; g++) {
+			UINT64 *chunk = table[chunkIndex(g)];
+			if (!chunk)
+				continue;
+			UINT64 entry = chunk[g & (SHADOW_CHUNK_ENTRIES - 1)];
+			if ((entry & ~SHADOW_STAMP_MASK) == owner && (entry & SHADOW_STAMP_MASK) > last)
+				last = entry & SHADOW_STAMP_MASK;
+		}
+		return last;
+	}
+
+	// Marks every granule in [addr, addr + size) as stored by thread tid at stamp
+	VOID recordStore(ADDRINT addr, UINT32 size, THREADID tid, UINT64 stamp) {
+		UINT64 entry = threadTag(tid) | (stamp & SHADOW_STAMP_MASK);
+		for (ADDRINT g = addr >> SHADOW_GRANULE_BITS; g <= (addr + size - 1) >> SHADOW_GRANULE_BITS; g++)
+			getChunk(chunkIndex(g))[g & (SHADOW_CHUNK_ENTRIES - 1)] = entry;
+	}
+
+	private:
+	static UINT64 threadTag(THREADID tid) {
+		return (UINT64)(tid + 1) << SHADOW_STAMP_BITS;
+	}
+
+	static UINT64 chunkIndex(ADDRINT granule) {
+		return (granule >> (SHADOW_CHUNK_BITS - SHADOW_GRANULE_BITS)) & (SHADOW_TABLE_ENTRIES - 1);
+	}
+
+	UINT64 *getChunk(UINT64 index) {
+		UINT64 *chunk = table[index];
+		if (chunk)
+			return chunk;
+
+		// Another thread may be allocating the same chunk
+		PIN_GetLock(&chunkLock, PIN_ThreadId() + 1);
+		if (!table[index])
+			table[index] = (UINT64*)calloc(SHADOW_CHUNK_ENTRIES, sizeof(UINT64));
+		chunk = table[index];
+		PIN_ReleaseLock(&chunkLock);
+		return chunk;
+	}
+
+	UINT64 **table;
+	PIN_LOCK chunkLock;
+};
+
+static ShadowMemory *shadowMemory;
+
+// One machine in the ilp limit study. Results are merged from every thread
+// as it exits.
+struct IlpConfig {
+	UINT32 window;
+	UINT32 width;
+	// Completion cycle of the last store to each granule, with -ilpmem. Shared
+	// by every thread, but each only sees its own stores.
+	ShadowMemory *memReady;
+	UINT64 instructions;
+	UINT64 cycles;
+};
+
+static std::vector<IlpConfig> ilpConfigs;
 
-static UINT64 ins_count = 0;
-void docount() {
-	ins_count++;
+// Per-thread schedule for one IlpConfig. Every instruction takes one cycle
+// once its operands are ready, dispatches in order at most `width` per
+// cycle, and cannot dispatch until the instruction `window` older retires.
+struct IlpState {
+	// Cycle each register's latest value becomes available, indexed by REG
+	UINT64 regReady[REG_LAST];
+	// Retire cycles of the last `window` instructions
+	UINT64 *retired;
+	// First free dispatch cycle of each of the last `width` instructions' slots
+	UINT64 *dispatchSlots;
+	UINT64 lastRetire;
+	// Instructions scheduled and cycles added to the schedule while recording
+	UINT64 instructions;
+	UINT64 cycles;
+	// Ready cycle of the loads of the instruction about to be scheduled
+	UINT64 memReady;
+	// Completion cycle of the last scheduled instruction
+	UINT64 complete;
+};
+
+// Per-thread state. Instruction counts and last writers are tracked per
+// thread so threaded applications don't see each other's registers.
+struct ThreadData {
+	THREADID tid;
+	// Instructions executed by this thread, up to the end of the current block
+	UINT64 ins_count;
+	// Instruction count of the last write to each register, indexed by REG
+	UINT64 last_reg_write[REG_LAST];
+	UINT64 *spacing;
+	UINT64 *sizeSpacing[NUM_SIZE_CLASSES];
+	// One schedule per entry in ilpConfigs
+	IlpState *ilp;
+};
+
+static TLS_KEY tlsKey;
+
+// Tool register holding the current thread's ThreadData, so analysis
+// routines get it without a TLS lookup.
+static REG scratchReg;
+
+static PIN_LOCK spacingLock;
+
+// Called once at the start of every basic block with its instruction count
+VOID PIN_FAST_ANALYSIS_CALL docount(ThreadData *tdata, UINT32 numIns) {
+	tdata->ins_count += numIns;
+}
+
+// Called before every instruction that reads or writes a register. insFromEnd
+// is the instruction's distance from the end of its block, which recovers its
+// own instruction count from the per-block counter. Reads are handled before
+// writes so an instruction never depends on itself.
+VOID PIN_FAST_ANALYSIS_CALL updateDependencies(ThreadData *tdata, InsRegs *regs, UINT32 insFromEnd) {
+	UINT64 ins_count = tdata->ins_count - insFromEnd;
+
+	for (UINT32 i = 0; i < regs->numReads; i++) {
+		UINT64 spacing = ins_count - tdata->last_reg_write[regs->reads[i]];
+		if (spacing < (UINT64)maxSize && regionsRecord())
+			tdata->spacing[spacing]++;
+	}
+
+	for (UINT32 i = 0; i < regs->numWrites; i++)
+		tdata->last_reg_write[regs->writes[i]] = ins_count;
 }
 
+// Called before every instruction in ilp mode, after the calls for its loads.
+// Schedules the instruction on every configured machine.
+VOID PIN_FAST_ANALYSIS_CALL ilpSchedule(ThreadData *tdata, InsRegs *regs, UINT32 insFromEnd) {
+	UINT64 ins_count = tdata->ins_count - insFromEnd;
+
+	for (UINT32 c = 0; c < ilpConfigs.size(); c++) {
+		const IlpConfig &config = ilpConfigs[c];
+		IlpState &state = tdata->ilp[c];
+
+		UINT64 dispatch = 0;
+		if (config.window) {
+			UINT64 oldestRetired = state.retired[ins_count % config.window];
+			if (oldestRetired > dispatch)
+				dispatch = oldestRetired;
+		}
+		if (config.width) {
+			UINT64 &slot = state.dispatchSlots[ins_count % config.width];
+			if (slot > dispatch)
+				dispatch = slot;
+			slot = dispatch + 1;
+		}
+
+		UINT64 issue = dispatch > state.memReady ? dispatch : state.memReady;
+		for (UINT32 i = 0; i < regs->numReads; i++)
+			if (state.regReady[regs->reads[i]] > issue)
+				issue = state.regReady[regs->reads[i]];
+
+		UINT64 complete = issue + 1;
+		for (UINT32 i = 0; i < regs->numWrites; i++)
+			state.regReady[regs->writes[i]] = complete;
+
+		if (complete > state.lastRetire) {
+			if (regionsRecord())
+				state.cycles += complete - state.lastRetire;
+			state.lastRetire = complete;
+		}
+		if (regionsRecord())
+			state.instructions++;
+		if (config.window)
+			state.retired[ins_count % config.window] = state.lastRetire;
+
+		state.complete = complete;
+		state.memReady = 0;
+	}
+}
 
-static std::map<REG, UINT64> last_reg_write;
-void updateRegAccessIns(REG reg) {
-	last_reg_write[reg] = ins_count;
+// Called for every memory operand read in ilp mode with -ilpmem
+VOID PIN_FAST_ANALYSIS_CALL ilpLoad(ThreadData *tdata, ADDRINT addr, UINT32 size) {
+	for (UINT32 c = 0; c < ilpConfigs.size(); c++) {
+		UINT64 ready = ilpConfigs[c].memReady->lastStore(addr, size, tdata->tid);
+		if (ready > tdata->ilp[c].memReady)
+			tdata->ilp[c].memReady = ready;
+	}
 }
 
+// Called for every memory operand written in ilp mode with -ilpmem, after
+// the instruction has been scheduled
+VOID PIN_FAST_ANALYSIS_CALL ilpStore(ThreadData *tdata, ADDRINT addr, UINT32 size) {
+	for (UINT32 c = 0; c < ilpConfigs.size(); c++)
+		ilpConfigs[c].memReady->recordStore(addr, size, tdata->tid, tdata->ilp[c].complete);
+}
 
-// Uncomment this and the code in updateSpacingInfo and Fini to write out the dependency history
-// for each register used
-//static std::map<REG, std::vector<UINT64>> reg_dependency_history;
+// Maps an access size in bytes to its histogram (log2 of the size, capped)
+static inline UINT32 sizeClass(UINT32 size) {
+	UINT32 sizeLog = 0;
+	while ((1u << (sizeLog + 1)) <= size && sizeLog < NUM_SIZE_CLASSES - 1)
+		sizeLog++;
+	return sizeLog;
+}
 
+// Called for every memory operand an instruction reads. The spacing is
+// measured from this thread's last store to any byte of the loaded range.
+// Loads of memory this thread did not store last are skipped.
+VOID PIN_FAST_ANALYSIS_CALL memoryLoad(ThreadData *tdata, ADDRINT addr, UINT32 size, UINT32 insFromEnd) {
+	UINT64 lastStore = shadowMemory->lastStore(addr, size, tdata->tid);
+	if (lastStore == 0)
+		return;
 
-// This function is called before every instruction is executed. Have to change
-// the code to send in the register names from the Instrumentation function
-VOID updateSpacingInfo(REG reg) {
-	UINT64 spacing = ins_count - last_reg_write[reg];
-	if (spacing >= 100) return; // sub 100 for maxSpacing because of int/uint comparison
-	dependancySpacing[spacing]++;
-	//reg_dependency_history[reg].push_back(spacing);
+	UINT64 spacing = tdata->ins_count - insFromEnd - lastStore;
+	if (spacing < (UINT64)maxSize && regionsRecord()) {
+		tdata->spacing[spacing]++;
+		tdata->sizeSpacing[sizeClass(size)][spacing]++;
+	}
 }
 
+// Called for every memory operand an instruction writes
+VOID PIN_FAST_ANALYSIS_CALL memoryStore(ThreadData *tdata, ADDRINT addr, UINT32 size, UINT32 insFromEnd) {
+	shadowMemory->recordStore(addr, size, tdata->tid, tdata->ins_count - insFromEnd);
+}
 
-// Pin calls this function every time a new instruction is encountered
-VOID Instruction(INS ins, VOID *v)
+// Inserts the load and store calls for one instruction. Loads go first so a
+// read-modify-write sees the previous store rather than its own.
+static VOID instrumentMemory(INS ins, UINT32 insFromEnd) {
+	UINT32 memOperands = INS_MemoryOperandCount(ins);
+	for (UINT32 op = 0; op < memOperands; op++) {
+		if (INS_MemoryOperandIsRead(ins, op))
+			INS_InsertPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)memoryLoad, IARG_FAST_ANALYSIS_CALL,
+									 IARG_REG_VALUE, scratchReg, IARG_MEMORYOP_EA, op,
+									 IARG_UINT32, INS_MemoryOperandSize(ins, op),
+									 IARG_UINT32, insFromEnd, IARG_END);
+	}
+	for (UINT32 op = 0; op < memOperands; op++) {
+		if (INS_MemoryOperandIsWritten(ins, op))
+			INS_InsertPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)memoryStore, IARG_FAST_ANALYSIS_CALL,
+									 IARG_REG_VALUE, scratchReg, IARG_MEMORYOP_EA, op,
+									 IARG_UINT32, INS_MemoryOperandSize(ins, op),
+									 IARG_UINT32, insFromEnd, IARG_END);
+	}
+}
+
+// Inserts the ilp scheduling call for one instruction, between the calls for
+// its loads and its stores. Every instruction is scheduled, even without
+// register operands, since each one occupies the window and a dispatch slot.
+static VOID instrumentIlp(INS ins, InsRegs *regs, UINT32 insFromEnd) {
+	UINT32 memOperands = KnobIlpMemory.Value() ? INS_MemoryOperandCount(ins) : 0;
+	for (UINT32 op = 0; op < memOperands; op++) {
+		if (INS_MemoryOperandIsRead(ins, op))
+			INS_InsertPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)ilpLoad, IARG_FAST_ANALYSIS_CALL,
+									 IARG_REG_VALUE, scratchReg, IARG_MEMORYOP_EA, op,
+									 IARG_UINT32, INS_MemoryOperandSize(ins, op), IARG_END);
+	}
+
+	INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)ilpSchedule, IARG_FAST_ANALYSIS_CALL,
+				   IARG_REG_VALUE, scratchReg, IARG_PTR, regs,
+				   IARG_UINT32, insFromEnd, IARG_END);
+
+	for (UINT32 op = 0; op < memOperands; op++) {
+		if (INS_MemoryOperandIsWritten(ins, op))
+			INS_InsertPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)ilpStore, IARG_FAST_ANALYSIS_CALL,
+									 IARG_REG_VALUE, scratchReg, IARG_MEMORYOP_EA, op,
+									 IARG_UINT32, INS_MemoryOperandSize(ins, op), IARG_END);
+	}
+}
+
+// Pin calls this function every time a new trace is encountered
+VOID Trace(TRACE trace, VOID *v)
+{
+	if (!regionsInstrument())
+		return;
+
+	for (BBL bbl = TRACE_BblHead(trace); BBL_Valid(bbl); bbl = BBL_Next(bbl)) {
+		UINT32 numIns = BBL_NumIns(bbl);
+		BBL_InsertCall(bbl, IPOINT_BEFORE, (AFUNPTR)docount, IARG_FAST_ANALYSIS_CALL,
+					   IARG_REG_VALUE, scratchReg, IARG_UINT32, numIns, IARG_END);
+
+		UINT32 index = 0;
+		for (INS ins = BBL_InsHead(bbl); INS_Valid(ins); ins = INS_Next(ins), index++) {
+			if (mode == MODE_MEM) {
+				instrumentMemory(ins, numIns - 1 - index);
+				continue;
+			}
+
+			// The limit study assumes perfect branch prediction, so control flow
+			// does not order instructions
+			InsRegs *regs = getInsRegs(ins, USE_FULL_REGISTERS_ONLY, mode == MODE_ILP);
+
+			if (mode == MODE_ILP) {
+				instrumentIlp(ins, regs, numIns - 1 - index);
+				continue;
+			}
+
+			if (regs->numReads == 0 && regs->numWrites == 0)
+				continue;
+
+			INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)updateDependencies, IARG_FAST_ANALYSIS_CALL,
+						   IARG_REG_VALUE, scratchReg, IARG_PTR, regs,
+						   IARG_UINT32, numIns - 1 - index, IARG_END);
+		}
+	}
+}
+
+VOID ThreadStart(THREADID tid, CONTEXT *ctxt, INT32 flags, VOID *v)
+{
+	// Shadow memory tags can't tell more threads apart
+	if ((mode == MODE_MEM || KnobIlpMemory.Value()) && tid >= SHADOW_MAX_THREADS) {
+		cerr << "Memory dependencies support at most " << SHADOW_MAX_THREADS << " threads" << endl;
+		PIN_ExitProcess(1);
+	}
+
+	ThreadData *tdata = new ThreadData;
+	tdata->tid = tid;
+	tdata->ins_count = 0;
+	for (UINT32 i = 0; i < REG_LAST; i++)
+		tdata->last_reg_write[i] = 0;
+	tdata->spacing = new UINT64[maxSize]();
+	for (UINT32 s = 0; s < NUM_SIZE_CLASSES; s++)
+		tdata->sizeSpacing[s] = mode == MODE_MEM ? new UINT64[maxSize]() : 0;
+
+	tdata->ilp = new IlpState[ilpConfigs.size()];
+	for (UINT32 c = 0; c < ilpConfigs.size(); c++) {
+		IlpState &state = tdata->ilp[c];
+		for (UINT32 i = 0; i < REG_LAST; i++)
+			state.regReady[i] = 0;
+		state.retired = new UINT64[ilpConfigs[c].window]();
+		state.dispatchSlots = new UINT64[ilpConfigs[c].width]();
+		state.lastRetire = 0;
+		state.instructions = 0;
+		state.cycles = 0;
+		state.memReady = 0;
+		state.complete = 0;
+	}
+
+	PIN_SetThreadData(tlsKey, tdata, tid);
+	PIN_SetContextReg(ctxt, scratchReg, (ADDRINT)tdata);
+}
+
+// Folds the exiting thread's histogram into the program's
+VOID ThreadFini(THREADID tid, const CONTEXT *ctxt, INT32 code, VOID *v)
 {
-    // Insert a call to updateSpacingInfo before every instruction.
-    // You may need to add arguments to the call.
-	std::set<REG> written_registers;
-	INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)docount, IARG_END);
-	for (uint j = 0; j < INS_MaxNumWRegs(ins); j++) {
-		REG write_reg;
-		if (USE_FULL_REGISTERS_ONLY)
-			write_reg = REG_FullRegName(INS_RegW(ins, j));
-		else
-			write_reg = INS_RegW(ins, j);
-
-		// Don't instrument the same register more than once per instruction
-		if (written_registers.find(write_reg) == written_registers.end())
-			written_registers.insert(write_reg);
-		else
-			continue;
-
-		INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)updateRegAccessIns,
-					   IARG_UINT32, write_reg, IARG_END);
-	}
-
-	std::set<REG> read_registers;
-	for (uint i = 0; i < INS_MaxNumRRegs(ins); i++) {
-		REG read_reg = REG_FullRegName(INS_RegR(ins, i));
-		if (USE_FULL_REGISTERS_ONLY)
-			read_reg = REG_FullRegName(INS_RegR(ins, i));
-		else
-			read_reg = INS_RegR(ins, i);
-
-		// Don't record the same register more than once per instruction
-		if (read_registers.find(read_reg) == read_registers.end())
-			read_registers.insert(read_reg);
-		else
-			continue;
-
-		INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)updateSpacingInfo, 
-					   IARG_UINT32, read_reg, IARG_END);
+	ThreadData *tdata = static_cast<ThreadData*>(PIN_GetThreadData(tlsKey, tid));
+
+	PIN_GetLock(&spacingLock, tid + 1);
+	for (INT32 i = 0; i < maxSize; i++)
+		dependancySpacing[i] += tdata->spacing[i];
+	for (UINT32 s = 0; s < NUM_SIZE_CLASSES && mode == MODE_MEM; s++)
+		for (INT32 i = 0; i < maxSize; i++)
+			sizeSpacing[s][i] += tdata->sizeSpacing[s][i];
+
+	// Threads run side by side, so the program takes as long as its slowest
+	for (UINT32 c = 0; c < ilpConfigs.size(); c++) {
+		ilpConfigs[c].instructions += tdata->ilp[c].instructions;
+		if (tdata->ilp[c].cycles > ilpConfigs[c].cycles)
+			ilpConfigs[c].cycles = tdata->ilp[c].cycles;
+	}
+	PIN_ReleaseLock(&spacingLock);
+
+	for (UINT32 c = 0; c < ilpConfigs.size(); c++) {
+		delete[] tdata->ilp[c].retired;
+		delete[] tdata->ilp[c].dispatchSlots;
 	}
+	delete[] tdata->ilp;
+
+	delete[] tdata->spacing;
+	for (UINT32 s = 0; s < NUM_SIZE_CLASSES; s++)
+		delete[] tdata->sizeSpacing[s];
+	delete tdata;
+}
+
+// Writes one line per ilp machine: its window and width (0 is unbounded), the
+// instructions executed, the critical path length in cycles and the IPC
+static VOID writeIlpResults()
+{
+    OutFile.open(KnobOutputFile.Value().c_str());
+    OutFile << "window,width,instructions,cycles,ipc\n";
+    for (UINT32 c = 0; c < ilpConfigs.size(); c++) {
+        const IlpConfig &config = ilpConfigs[c];
+        OutFile << config.window << "," << config.width << ","
+                << config.instructions << "," << config.cycles << ","
+                << (config.cycles ? (double)config.instructions / config.cycles : 0.0) << "\n";
+    }
+    OutFile.close();
+}
+
+// Appends this run to the results store: one row per ilp machine, or the
+// dependency histogram plus (with -split) one row per load size
+static VOID storeResults()
+{
+    ResultsTable table;
+    if (mode == MODE_ILP) {
+        for (UINT32 c = 0; c < ilpConfigs.size(); c++) {
+            const IlpConfig &config = ilpConfigs[c];
+            resultsAddRow(table, "regDeps", benchmarkName);
+            table.setString("mode", KnobMode.Value());
+            table.setUint("ilpmem", KnobIlpMemory.Value());
+            table.setUint("window", config.window);
+            table.setUint("width", config.width);
+            table.setUint("instructions", config.instructions);
+            table.setUint("cycles", config.cycles);
+            table.setDouble("ipc", config.cycles ? (double)config.instructions / config.cycles : 0.0);
+        }
+    } else {
+        resultsAddRow(table, "regDeps", benchmarkName);
+        table.setString("mode", KnobMode.Value());
+        table.setUint("size", 0);
+        table.setArray("spacing", dependancySpacing, maxSize);
+
+        for (UINT32 s = 0; s < NUM_SIZE_CLASSES && mode == MODE_MEM && KnobSplitBySize.Value(); s++) {
+            resultsAddRow(table, "regDeps", benchmarkName);
+            table.setString("mode", KnobMode.Value());
+            table.setUint("size", 1u << s);
+            table.setArray("spacing", sizeSpacing[s], maxSize);
+        }
+    }
+
+    if (!table.append(KnobResultsStore.Value()))
+        cerr << "Cannot append to " << KnobResultsStore.Value() << endl;
+}
+
+// Parses a comma separated list of numbers
+static std::vector<UINT32> parseList(const string &list)
+{
+    std::vector<UINT32> values;
+    istringstream stream(list);
+    string item;
+    while (getline(stream, item, ','))
+        if (!item.empty())
+            values.push_back(atoi(item.c_str()));
+    return values;
 }
 
 // This function is called when the application exits
 VOID Fini(INT32 code, VOID *v)
 {
-	/*
-	OutFile.open(HistoryOutputFile.Value().c_str());
-	OutFile.setf(ios::showbase);
-	for (std::map<REG, std::vector<UINT64>>::iterator it = reg_dependency_history.begin(); it != reg_dependency_history.end(); ++it)
-	{
-		OutFile << it->first << ": ";
-		for (std::vector<UINT64>::iterator vt = it->second.begin(); vt != it->second.end(); ++vt)
-		{
-			OutFile << *vt << ", ";
-		}
-		OutFile << std::endl;
-	}
-	OutFile.close();
-	*/
+    if (!KnobResultsStore.Value().empty()) {
+        storeResults();
+        return;
+    }
+
+    if (mode == MODE_ILP) {
+        writeIlpResults();
+        return;
+    }
 
     // Write to a file since cout and cerr maybe closed by the application
     OutFile.open(KnobOutputFile.Value().c_str());
@@ -122,6 +544,19 @@ VOID Fini(INT32 code, VOID *v)
 	for(INT32 i = 0; i < maxSize; i++)
 		OutFile << dependancySpacing[i]<<",";
     OutFile.close();
+
+    if (mode != MODE_MEM || !KnobSplitBySize.Value())
+        return;
+
+    // One more file per load size, in the same format
+    for (UINT32 s = 0; s < NUM_SIZE_CLASSES; s++) {
+        ostringstream sizeFile;
+        sizeFile << KnobOutputFile.Value() << ".size" << (1u << s);
+        OutFile.open(sizeFile.str().c_str());
+        for (INT32 i = 0; i < maxSize; i++)
+            OutFile << sizeSpacing[s][i] << ",";
+        OutFile.close();
+    }
 }
 
 // argc, argv are the entire command line, including pin -t <toolname> -- ...
@@ -129,22 +564,58 @@ int main(int argc, char * argv[])
 {
     // Initialize pin
     PIN_Init(argc, argv);
+    initRegions();
+    benchmarkName = resultsBenchmark(argc, argv);
 
-    //printf("Warning: Pin Tool not implemented\n");
     maxSize = atoi(KnobMaxSpacing.Value().c_str());
 
     // Initializing depdendancy Spacing
-    dependancySpacing = new UINT64[maxSize];
+    dependancySpacing = new UINT64[maxSize]();
+
+    if (KnobMode.Value() == "mem") {
+        mode = MODE_MEM;
+        shadowMemory = new ShadowMemory();
+        for (UINT32 s = 0; s < NUM_SIZE_CLASSES; s++)
+            sizeSpacing[s] = new UINT64[maxSize]();
+    } else if (KnobMode.Value() == "ilp") {
+        mode = MODE_ILP;
+        std::vector<UINT32> windows = parseList(KnobWindowSizes.Value());
+        std::vector<UINT32> widths = parseList(KnobIssueWidths.Value());
+        for (UINT32 i = 0; i < windows.size(); i++) {
+            for (UINT32 j = 0; j < widths.size(); j++) {
+                IlpConfig config;
+                config.window = windows[i];
+                config.width = widths[j];
+                config.memReady = KnobIlpMemory.Value() ? new ShadowMemory() : 0;
+                config.instructions = 0;
+                config.cycles = 0;
+                ilpConfigs.push_back(config);
+            }
+        }
+    } else if (KnobMode.Value() != "reg") {
+        cerr << "Unknown mode " << KnobMode.Value() << ", expected reg, mem or ilp" << endl;
+        return 1;
+    }
+
+    PIN_InitLock(&spacingLock);
+    tlsKey = PIN_CreateThreadDataKey(0);
+    scratchReg = PIN_ClaimToolRegister();
+    if (!REG_valid(scratchReg)) {
+        cerr << "Cannot allocate a scratch register" << endl;
+        return 1;
+    }
+
+    // Register Trace to be called to instrument basic blocks
+    TRACE_AddInstrumentFunction(Trace, 0);
 
-    // Register Instruction to be called to instrument instructions
-    INS_AddInstrumentFunction(Instruction, 0);
+    PIN_AddThreadStartFunction(ThreadStart, 0);
+    PIN_AddThreadFiniFunction(ThreadFini, 0);
 
     // Register Fini to be called when the application exits
     PIN_AddFiniFunction(Fini, 0);
-    
+
     // Start the program, never returns
     PIN_StartProgram();
-    
+
     return 0;
 }
-
@@ -7,9 +7,9 @@
 #include <string>
 #include <bitset>
 #include "pin.H"
-
-#define NUM_ADDRESS_TABLE_ENTRIES 512
-#define NUM_PATTERN_HIST_TABLE_ENTRIES 512
+#include "sim_regions.h"
+#include "results_store.h"
+#include "branch_predictors.h"
 
 static UINT64 takenCorrect = 0;
 static UINT64 takenIncorrect = 0;
@@ -17,183 +17,11 @@ static UINT64 notTakenCorrect = 0;
 static UINT64 notTakenIncorrect = 0;
 
 
-// Defines the states for a two-bit saturating predictor
-enum PREDICTOR {
-	STRONGLY_NOT_TAKEN = 0,
-	WEAKLY_NOT_TAKEN,
-	WEAKLY_TAKEN,
-	STRONGLY_TAKEN
-};
-
-// Returns a two-bit saturating predictor's prediction
-BOOL get_prediction(const PREDICTOR &predictor) {
-	switch (predictor) {
-		case STRONGLY_TAKEN:
-		case WEAKLY_TAKEN:
-			return TRUE;
-		case WEAKLY_NOT_TAKEN:
-		case STRONGLY_NOT_TAKEN:
-			return FALSE;
-		default:
-			return TRUE;
-		}
-}
-
-// Returns a new predictor based off the result of the old one's prediction
-PREDICTOR get_new_pred_state(const PREDICTOR &old_predictor, const BOOL &takenActually) {
-	PREDICTOR new_predictor = old_predictor;
-
-	switch (old_predictor) {
-		case STRONGLY_TAKEN:
-			if (!takenActually)
-				new_predictor = WEAKLY_TAKEN;
-			break;
-		case WEAKLY_TAKEN:
-			if (takenActually)
-				new_predictor = STRONGLY_TAKEN;
-			else
-				new_predictor = WEAKLY_NOT_TAKEN;
-			break;
-		case WEAKLY_NOT_TAKEN:
-			if (takenActually)
-				new_predictor = WEAKLY_TAKEN;
-			else
-				new_predictor = STRONGLY_NOT_TAKEN;
-			break;
-		case STRONGLY_NOT_TAKEN:
-			if (takenActually)
-				new_predictor = WEAKLY_NOT_TAKEN;
-			break;
-		}
-	return new_predictor;
-}
-
-class BranchPredictor {
-
-  public:
-  BranchPredictor() { }
-
-  virtual BOOL makePrediction(ADDRINT address) { return FALSE;};
-
-  virtual void makeUpdate(BOOL takenActually, BOOL takenPredicted, ADDRINT address) {};
-
-  virtual void Finish() {};
-};
-
-class gsharePredictor: public BranchPredictor {
-	public:
-	gsharePredictor() {}
-
-	BOOL makePrediction(ADDRINT address) {
-		UINT16 predictor_index = (address ^ history_register) & mask;
-		return get_prediction((PREDICTOR)predictors[predictor_index]);
-	}
-
-	void makeUpdate(BOOL takenActually, BOOL takenPredicted, ADDRINT address) {
-		// Update the counter
-		UINT16 predictor_index = (address ^ history_register) & mask;
-		PREDICTOR old_predictor = (PREDICTOR)predictors[predictor_index];
-		PREDICTOR new_predictor = get_new_pred_state(old_predictor, takenActually);
-		predictors[predictor_index] = (UINT8)new_predictor;
-
-		// Update the history register
-		history_register = (history_register << 1) & takenActually;
-	}
-
-	private:
-	UINT16 history_register; // 16-bit (global) history register
-	UINT8 predictors[2048] = { WEAKLY_TAKEN };
-	UINT16 mask = 0x7FF; // Masks UINT16s so they fit into the predictor's array range
-};
-
-
-class twoLevelAdaptivePredictor: public BranchPredictor {
-	public:
-	twoLevelAdaptivePredictor() {
-		address_index_mask = NUM_ADDRESS_TABLE_ENTRIES - 1;
-		history_index_mask = NUM_PATTERN_HIST_TABLE_ENTRIES - 1;
-	}
-
-	BOOL makePrediction(ADDRINT address) {
-		// Find the indices of the branch's history, and its predictor
-		UINT16 address_index = address & address_index_mask;
-		UINT8 grh_entry = address_branch_histories[address_index] & history_index_mask;
-		PREDICTOR predictor = (PREDICTOR)branch_pattern_selectors[grh_entry];
-		return get_prediction(predictor);
-	}
-
-  void makeUpdate(BOOL takenActually, BOOL takenPredicted, ADDRINT address) {
-		UINT16 address_index = address & address_index_mask;
-		UINT16 grh_entry = address_branch_histories[address_index];
-		UINT16 grh_index = grh_entry & history_index_mask;
-
-		// Update the predictor for this history
-		PREDICTOR old_predictor = (PREDICTOR)branch_pattern_selectors[grh_index];
-		PREDICTOR new_predictor = get_new_pred_state(old_predictor, takenActually);
-		branch_pattern_selectors[grh_index] = new_predictor;
-
-		// Update the history for this address
-		address_branch_histories[address_index] = (grh_entry << 1) | takenActually;
-	}
-
-  void Finish() {};
-
-	private:
-	// Masks that ensure the indices never go outside the bounds of their arrays
-	UINT16 address_index_mask;
-	UINT16 history_index_mask;
-
-	// The arrays for the address-specific branch histories, and the (global)
-	// saturating predictors (use UINT8 instead of PREDICTOR to save on memory)
-	UINT8 address_branch_histories[NUM_ADDRESS_TABLE_ENTRIES];
-	UINT8 branch_pattern_selectors[NUM_PATTERN_HIST_TABLE_ENTRIES] = { WEAKLY_TAKEN } ;
-};
-
-// Combining predictor: Chooses between two different predictors for flexibility
-class myBranchPredictor: public BranchPredictor {
-	public:
-	myBranchPredictor() {
-		bp1 = new gsharePredictor;
-		bp2 = new twoLevelAdaptivePredictor;
-	}
-
-	BOOL makePrediction(ADDRINT address) {
-		if (selector <=1)
-			return bp1->makePrediction(address);
-		else
-			return bp2->makePrediction(address);
-	}
-
-	void makeUpdate(BOOL takenActually, BOOL takenPredicted, ADDRINT address) {
-		// Update the individual predictors (even if they weren't used)
-		bp1->makeUpdate(takenActually, takenPredicted, address);
-		bp2->makeUpdate(takenActually, takenPredicted, address);
-
-		// Update our selector
-		if (takenPredicted == takenActually) {
-			if (selector == 1)
-				selector = 0;
-			else if (selector == 2)
-				selector = 3;
-		} else {
-			if (selector <= 1)
-				selector++;
-			else
-				selector--;
-		}
-	}
-
-	private:
-		BranchPredictor* bp1;
-		BranchPredictor* bp2;
-		// Two bit saturating counter that chooses which predictor to use.
-		// 0-1, choose bp1
-		// 2-3, choose bp2
-		UINT8 selector = 1; // 0-1, choose bp1. 2-3, choose bp2
-};
-
 BranchPredictor* BP;
 
+// Benchmark name for the results store
+static string benchmarkName;
+
 
 // This knob sets the output file name
 KNOB<string> KnobOutputFile(KNOB_MODE_WRITEONCE, "pintool", "o", "result.out", "specify the output file name");
@@ -207,6 +35,10 @@ void handleBranch(ADDRINT ip, BOOL direction)
   BOOL prediction = BP->makePrediction(ip);
   BP->makeUpdate(direction, prediction, ip);
 
+  // Warm-up trains the predictor without counting
+  if (!regionsRecord())
+    return;
+
   if(prediction) {
     if(direction) {
       takenCorrect++;
@@ -227,6 +59,9 @@ void handleBranch(ADDRINT ip, BOOL direction)
 
 void instrumentBranch(INS ins, void * v)
 {
+  if (!regionsInstrument())
+    return;
+
   if(INS_IsBranch(ins) && INS_HasFallThrough(ins)) {
     INS_InsertCall(
       ins, IPOINT_TAKEN_BRANCH, (AFUNPTR)handleBranch,
@@ -249,6 +84,19 @@ void instrumentBranch(INS ins, void * v)
 VOID Fini(int, VOID * v)
 {
   BP->Finish();
+
+  if (!KnobResultsStore.Value().empty()) {
+    ResultsTable table;
+    resultsAddRow(table, "bpredictor", benchmarkName);
+    table.setUint("takenCorrect", takenCorrect);
+    table.setUint("takenIncorrect", takenIncorrect);
+    table.setUint("notTakenCorrect", notTakenCorrect);
+    table.setUint("notTakenIncorrect", notTakenIncorrect);
+    if (!table.append(KnobResultsStore.Value()))
+      cerr << "Cannot append to " << KnobResultsStore.Value() << endl;
+    return;
+  }
+
   ofstream outfile;
   outfile.open(KnobOutputFile.Value().c_str());
   outfile.setf(ios::showbase);
@@ -265,6 +113,8 @@ int main(int argc, char * argv[])
 
     // Initialize pin
     PIN_Init(argc, argv);
+    initRegions();
+    benchmarkName = resultsBenchmark(argc, argv);
 
     // Register Instruction to be called to instrument instructions
     INS_AddInstrumentFunction(instrumentBranch, 0);
@@ -3,6 +3,9 @@ from pathlib import Path
 import sys
 import re
 
+sys.path.insert(0, str(Path(__file__).resolve().parent.parent / 'common'))
+from resultsdb import ResultsDB
+
 pattern = re.compile(r'takenCorrect: (\d+)  takenIncorrect: (\d+) notTakenCorrect: (\d+) notTakenIncorrect: (\d+)')
 
 
@@ -15,7 +18,20 @@ def read_results_file(result_file):
 		raise ValueError('Invalid results file')
 
 	return [int(g) for g in m.groups()]
-	
+
+
+def region_label(row):
+	"""Describes the simulation region knobs of a run, if any were set."""
+	knobs = [f'{k}={row[k]}' for k in ('ff', 'warmup', 'detail', 'period') if row.get(k)]
+	return f" [{' '.join(knobs)}]" if knobs else ''
+
+
+def read_results_store(results_store, benchmark=None):
+	"""Returns (benchmark, results) for every bpredictor run in the store."""
+	fields = ('takenCorrect', 'takenIncorrect', 'notTakenCorrect', 'notTakenIncorrect')
+	return [(row['benchmark'] + region_label(row), [row[f] for f in fields])
+			for row in ResultsDB(results_store).rows(tool='bpredictor', benchmark=benchmark)]
+
 
 def print_results(results, title):
 
@@ -38,7 +54,17 @@ if __name__ == '__main__':
 		sys.exit()	
 	
 	result_path = Path(sys.argv[1])
-	if result_path.is_dir():
+	if result_path.suffix == '.rdb':
+		# A results store, optionally followed by --bench <name>
+		benchmark = sys.argv[3] if len(sys.argv) > 3 and sys.argv[2] == '--bench' else None
+		total_results = [0, 0, 0, 0]
+		for name, results in read_results_store(str(result_path), benchmark):
+			print_results(results, name)
+			total_results = [t + r for t, r in zip(total_results, results)]
+
+		print_results(total_results, 'Total')
+
+	elif result_path.is_dir():
 		total_results = [0, 0, 0, 0]
 		for result_file in result_path.glob('**/*.out'):
 			short_name = result_file.name.split('_')[0]
@@ -1,43 +1,43 @@
-from collections import namedtuple
+from collections import defaultdict, namedtuple
 from pathlib import Path
+import sys
 import matplotlib.pyplot as plt
 
-Results = namedtuple('Results', 'PIPT VIPT VIVT')
-
+sys.path.insert(0, str(Path(__file__).resolve().parent.parent / 'common'))
+from resultsdb import ResultsDB
 
-def load_results(results_file):
-    results = {}
-    with open(results_file) as f:
-        result_text = f.readlines()
-        for line in result_text:
-            name, values = line.split(':')
-            name = ''.join(n[0].upper() for n in name.split())
-            r_cnt, w_cnt, r_hit, w_hit = [int(v) for v in values.strip().split(',')]
-            total_miss_rate = 1 - ((r_hit + w_hit) / (r_cnt + w_cnt))
-            results[name] = total_miss_rate
-    return Results(**results)
+Results = namedtuple('Results', 'PIPT VIPT VIVT')
 
 
 class Simulation:
-    def __init__(self, sim_dir):
-        self.dir = sim_dir
-        params = [int(i) for i in sim_dir.name.split('_')]
+    def __init__(self, params, runs):
         self.log_num_rows, self.log_block_size, self.associativity = params
-        self.runs = {}
-        for s in sim_dir.iterdir():
-            run_name = s.name.replace(s.suffix, '')
-            self.runs[run_name] = load_results(s)
+        self.runs = runs
 
     @property
     def params(self):
         return self.log_num_rows, self.log_block_size, self.associativity
 
     def __repr__(self):
-        return f'Simulation("{self.dir}")'
+        return f'Simulation{self.params}'
+
+
+def load_simulations(results_store):
+    """Groups the cache results in the store into one Simulation per
+    configuration, holding the miss rate of each model for each benchmark."""
+    miss_rates = defaultdict(lambda: defaultdict(dict))
+    for row in ResultsDB(results_store).rows(tool='caches'):
+        params = (row['r'], row['b'], row['a'])
+        name = ''.join(n[0].upper() for n in row['model'].split())
+        accesses = row['readReqs'] + row['writeReqs']
+        hits = row['readHits'] + row['writeHits']
+        miss_rates[params][row['benchmark']][name] = 1 - hits / accesses if accesses else 0
+    return [Simulation(params, {b: Results(**r) for b, r in runs.items()})
+            for params, runs in sorted(miss_rates.items())]
 
 
-sim_root = Path(r'D:\Documents\school\EC513\EC513\lab3\simulations')
-simulations = [Simulation(sim_dir) for sim_dir in sim_root.iterdir()]
+results_store = sys.argv[1] if len(sys.argv) > 1 else 'simulations.rdb'
+simulations = load_simulations(results_store)
 
 # Get the PARSEC program names. All simulations have the same names
 parsec_programs = tuple(simulations[0].runs.keys())
@@ -2,6 +2,9 @@
 import sys
 from pathlib import Path
 
+sys.path.insert(0, str(Path(__file__).resolve().parent.parent / 'common'))
+from resultsdb import ResultsDB
+
 if len(sys.argv) > 1:
     results_file = sys.argv[1]
 else:
@@ -20,6 +23,23 @@ def load_results(results_file):
     return results
 
 
+def region_label(row):
+    """Describes the simulation region knobs of a run, if any were set."""
+    knobs = [f'{k}={row[k]}' for k in ('ff', 'warmup', 'detail', 'period') if row.get(k)]
+    return f" [{' '.join(knobs)}]" if knobs else ''
+
+
+def load_results_store(results_store, benchmark=None):
+    """Returns {title: results} with one entry per caches run in the store,
+    holding the same tuples as load_results."""
+    runs = {}
+    for row in ResultsDB(results_store).rows(tool='caches', benchmark=benchmark):
+        title = f"{row['benchmark']} (r={row['r']} b={row['b']} a={row['a']})" + region_label(row)
+        runs.setdefault(title, {})[row['model']] = (row['readReqs'], row['readHits'],
+                                                   row['writeReqs'], row['writeHits'])
+    return runs
+
+
 def print_results(results, title):
     print(f'{title}:')
     for name, values in results.items():
@@ -44,7 +64,16 @@ if __name__ == '__main__':
         sys.exit()
 
     result_path = Path(sys.argv[1])
-    if result_path.is_dir():
+    if result_path.suffix == '.rdb':
+        # A results store, optionally followed by --bench <name>
+        benchmark = sys.argv[3] if len(sys.argv) > 3 and sys.argv[2] == '--bench' else None
+        max_inst = 0
+        for title, results in load_results_store(str(result_path), benchmark).items():
+            pp = results['physical index physical tag']
+            max_inst = max(max_inst, pp[0] + pp[2])
+            print_results(results, title)
+        print(f'Max # accesses: {max_inst}')
+    elif result_path.is_dir():
         dir_results = {}
         max_inst = 0
         for result_file in result_path.glob('**/*.out'):
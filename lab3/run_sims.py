@@ -41,6 +41,9 @@ fluidanimate = ('fluidanimate', os.path.join(binary_path, 'fluidanimate'),
 
 tests = (blackscholes, body_track, cholesky, ferret, fft, fluidanimate)
 
+# Every run appends its results to this store (see ../common/resultsdb.py)
+results_store = 'simulations.rdb'
+
 log_num_rows_opts = [str(i) for i in range(9, 17)]
 log_block_size_opts = [str(i) for i in range(2, 8)]
 associativity_opts = [str(i) for i in range(1, 8)]
@@ -55,12 +58,10 @@ def simple_test():
     log_block_size = '5'
     associativity = '2'
 
-    results_path = os.path.join('simulations', f'{log_num_rows}_{log_block_size}_{associativity}')
-    os.makedirs(results_path)
     running_tests = []
     for test in tests:
         args = ['../../base/pin/pin', '-t', 'caches.so',
-                '-o', os.path.join(results_path, f'{test[0]}.txt'),
+                '-db', results_store, '-bench', test[0],
                 '-r', log_num_rows, '-b', log_block_size, '-a', associativity,
                 '--', *test[1:]]
         running_tests.append(subprocess.Popen(args))
@@ -70,17 +71,11 @@ def simple_test():
 
 
 if __name__ == '__main__':
-    if not os.path.exists('simulations'):
-        os.mkdir('simulations')
-
     for log_num_rows, log_block_size, associativity in configs:
-        results_path = os.path.join('simulations',
-                                    f'{log_num_rows}_{log_block_size}_{associativity}')
-        os.makedirs(results_path)
         running_tests = []
         for test in tests:
             args = ['../../base/pin/pin', '-t', 'caches.so',
-                    '-o', os.path.join(results_path, f'{test[0]}.txt'),
+                    '-db', results_store, '-bench', test[0],
                     '-r', log_num_rows, '-b', log_block_size, '-a', associativity,
                     '--', *test[1:]]
             running_tests.append(subprocess.Popen(args))